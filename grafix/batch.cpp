@@ -0,0 +1,73 @@
+#include "entities.hpp"
+#include "batch.hpp"
+#include "utils.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+
+// runs the main scene for every combination of the parameters below and writes
+// run<i>.dat for each of them, batch.dat lists the parameters of every run.
+// usage: grafixBatch [duration] [output directory] [lanes]
+// lanes is how many worlds are stepped together, 1, 4 or 8
+int main(int argc, char** argv) {
+    double duration = argc > 1 ? std::atof(argv[1]) : 0.5;
+    std::string directory = argc > 2 ? argv[2] : ".";
+    int lanes = argc > 3 ? std::atoi(argv[3]) : 4;
+
+    std::vector<double> pdts = {1e-2, 1e-3, 1e-4};
+    std::vector<double> ks = {5000, 10000, 20000};
+    std::vector<double> ds = {40, 80, 160};
+    std::vector<double> mus = {0.25, 0.5, 1};
+    std::vector<double> Cds = {0.1, 0.25, 0.5};
+
+    std::vector<BatchRun> runs;
+    std::ofstream index(directory + "/batch.dat");
+    index << "# run dt k d mu Cd\n";
+    for (double pdt : pdts) {
+        for (double k : ks) {
+            for (double d : ds) {
+                for (double mu : mus) {
+                    for (double Cd : Cds) {
+                        BatchRun run;
+                        run.params.k = k;
+                        run.params.d = d;
+                        run.params.mu = mu;
+                        run.params.Cd = Cd;
+                        run.pdt = pdt;
+                        run.duration = duration;
+                        run.output = directory + "/run" + std::to_string(runs.size()) + ".dat";
+                        index << runs.size() << ' ' << pdt << ' ' << k << ' ' << d << ' ' << mu << ' ' << Cd << '\n';
+                        runs.push_back(run);
+                    }
+                }
+            }
+        }
+    }
+
+    size_t totalSteps = 0;
+    for (const BatchRun& run : runs) {
+        totalSteps += getStepCount(run);
+    }
+
+    auto buildScene = [](World& world) {
+        BodyHandle player = getPlayerAndEntities(world.bodies, 2);
+        // throw the player at the slope so there is a collision to measure
+        world.bodies.get(player)->vel = {-4, -2};
+        return player;
+    };
+
+    double time = getTime();
+    if (lanes == 8) {
+        runBatchLanes<8>(runs, buildScene);
+    } else if (lanes == 4) {
+        runBatchLanes<4>(runs, buildScene);
+    } else {
+        runBatch(runs, buildScene);
+    }
+    time = getTime() - time;
+
+    print(runs.size(), "runs,", totalSteps, "steps in", time, "s,", totalSteps/time, "steps/s");
+    return 0;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include "physics.hpp"
+#include "world.hpp"
+#include "bodyPool.hpp"
+#include "worldLanes.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+// one simulation of a batch
+struct BatchRun {
+    PhysicsParams params;
+    double pdt;
+    double duration;
+    std::string output;  // telemetry file, one "t a" line per step like the analyzer's .dat files
+};
+
+inline size_t getStepCount(const BatchRun& run) {
+    return static_cast<size_t>(std::llround(run.duration / run.pdt));
+}
+
+// step a world through a run and write the vertical acceleration of the tracked body after every step
+inline void simulate(World& world, BodyHandle tracked, const BatchRun& run) {
+    std::ofstream out(run.output);
+    Polygon* body = world.bodies.get(tracked);
+    size_t stepCount = getStepCount(run);
+    out << 0 << ' ' << body->acc.y << '\n';
+    for (size_t i = 0; i < stepCount; i++) {
+        physicsUpdate(world, run.pdt);
+        out << (i + 1)*run.pdt << ' ' << body->acc.y << '\n';
+    }
+}
+
+// step a lane group through its runs, runs[l] is simulated in lane l. lanes past the end of runs only fill the group
+template<size_t Lanes>
+void simulate(WorldLanes<Lanes>& lanes, const std::vector<BodyHandle>& tracked, const std::vector<const BatchRun*>& runs) {
+    std::vector<std::ofstream> outs;
+    std::vector<Polygon*> bodies;
+    for (size_t l = 0; l < runs.size(); l++) {
+        outs.emplace_back(runs[l]->output);
+        bodies.push_back(lanes.world(l).bodies.get(tracked[l]));
+        outs[l] << 0 << ' ' << bodies[l]->acc.y << '\n';
+    }
+    double pdt = runs[0]->pdt;
+    size_t stepCount = getStepCount(*runs[0]);
+    for (size_t i = 0; i < stepCount; i++) {
+        lanes.update(pdt);
+        for (size_t l = 0; l < runs.size(); l++) {
+            outs[l] << (i + 1)*pdt << ' ' << bodies[l]->acc.y << '\n';
+        }
+    }
+}
+
+// simulates every run in its own world, one world per thread at a time. the worlds are independent,
+// so there is nothing to synchronize and throughput scales with the thread count.
+// buildScene(world) fills a world and returns the body to record, it is called on this thread only,
+// since the vertex pool and shape cache are shared by all worlds and may only grow while nothing is stepping
+template<typename SceneBuilder>
+void runBatch(const std::vector<BatchRun>& runs, SceneBuilder buildScene, size_t threadCount = std::thread::hardware_concurrency()) {
+    std::vector<std::unique_ptr<World>> worlds;
+    std::vector<BodyHandle> tracked;
+    for (const BatchRun& run : runs) {
+        worlds.emplace_back(new World());
+        worlds.back()->params = run.params;
+        tracked.push_back(buildScene(*worlds.back()));
+    }
+
+    // longest runs first, so the last runs to finish are short ones
+    std::vector<size_t> order(runs.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&runs](size_t a, size_t b) {
+        return getStepCount(runs[a]) > getStepCount(runs[b]);
+    });
+
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        size_t i;
+        while ((i = next++) < order.size()) {
+            size_t run = order[i];
+            simulate(*worlds[run], tracked[run], runs[run]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::max<size_t>(threadCount, 1); i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// like runBatch, but runs with the same dt and step count are packed Lanes at a time into a WorldLanes,
+// so the scene is stepped once for all of them. every run still gets its own world and telemetry
+template<size_t Lanes, typename SceneBuilder>
+void runBatchLanes(const std::vector<BatchRun>& runs, SceneBuilder buildScene, size_t threadCount = std::thread::hardware_concurrency()) {
+    // group the runs that take the same steps, in the order they come
+    std::vector<std::vector<const BatchRun*>> groups;
+    for (const BatchRun& run : runs) {
+        auto group = std::find_if(groups.begin(), groups.end(), [&run](const std::vector<const BatchRun*>& group) {
+            return group.size() < Lanes && group[0]->pdt == run.pdt && getStepCount(*group[0]) == getStepCount(run);
+        });
+        if (group == groups.end()) {
+            groups.emplace_back();
+            group = groups.end() - 1;
+        }
+        group->push_back(&run);
+    }
+
+    // a group that isn't full repeats its last run in the remaining lanes
+    std::vector<std::unique_ptr<World>> worlds;
+    std::vector<std::unique_ptr<WorldLanes<Lanes>>> laneGroups;
+    std::vector<std::vector<BodyHandle>> tracked(groups.size());
+    for (size_t g = 0; g < groups.size(); g++) {
+        std::vector<World*> laneWorlds;
+        for (size_t l = 0; l < Lanes; l++) {
+            const BatchRun& run = *groups[g][std::min(l, groups[g].size() - 1)];
+            worlds.emplace_back(new World());
+            worlds.back()->params = run.params;
+            tracked[g].push_back(buildScene(*worlds.back()));
+            laneWorlds.push_back(worlds.back().get());
+        }
+        laneGroups.emplace_back(new WorldLanes<Lanes>(laneWorlds));
+    }
+
+    std::vector<size_t> order(groups.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&groups](size_t a, size_t b) {
+        return getStepCount(*groups[a][0]) > getStepCount(*groups[b][0]);
+    });
+
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        size_t i;
+        while ((i = next++) < order.size()) {
+            size_t group = order[i];
+            simulate(*laneGroups[group], tracked[group], groups[group]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::max<size_t>(threadCount, 1); i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include "polygon.hpp"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <utility>
+
+// refers to a body in a BodyPool, stays valid until that body is removed.
+// a removed body's slot gets a new generation, so old handles to it are detected instead of aliasing a new body
+struct BodyHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    bool operator==(const BodyHandle& other) const {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const BodyHandle& other) const {
+        return !(*this == other);
+    }
+};
+
+// owns the bodies of a scene. bodies are stored densely for iteration,
+// adding and removing is O(1) and never moves a body in memory
+class BodyPool {
+public:
+    template<typename T, typename... Args>
+    BodyHandle emplace(Args&&... args) {
+        return insert(std::unique_ptr<Polygon>(new T(std::forward<Args>(args)...)));
+    }
+
+    BodyHandle add(Polygon body) {
+        return emplace<Polygon>(std::move(body));
+    }
+
+    void remove(BodyHandle handle) {
+        if (!contains(handle)) {
+            return;
+        }
+        Slot& slot = slots[handle.index];
+        uint32_t denseIndex = slot.denseIndex;
+
+        // move the last body into the hole
+        uint32_t last = static_cast<uint32_t>(bodies.size() - 1);
+        if (denseIndex != last) {
+            bodies[denseIndex] = std::move(bodies[last]);
+            denseToSlot[denseIndex] = denseToSlot[last];
+            slots[denseToSlot[denseIndex]].denseIndex = denseIndex;
+        }
+        bodies.pop_back();
+        denseToSlot.pop_back();
+
+        slot.generation++;
+        slot.denseIndex = freeHead;
+        freeHead = handle.index;
+        version++;
+    }
+
+    bool contains(BodyHandle handle) const {
+        return handle.index < slots.size() && slots[handle.index].generation == handle.generation;
+    }
+
+    // returns nullptr if the body has been removed
+    Polygon* get(BodyHandle handle) const {
+        if (!contains(handle)) {
+            return nullptr;
+        }
+        return bodies[slots[handle.index].denseIndex].get();
+    }
+
+    BodyHandle getHandle(size_t denseIndex) const {
+        uint32_t index = denseToSlot[denseIndex];
+        return {index, slots[index].generation};
+    }
+
+    // room for count bodies in total, and room after what the shared vertex pool already uses for the vertices
+    // of the ones still to come, assuming they are no bigger than the inline size of a shape. adding bodies up to
+    // that then never reallocates a pool, as long as no other pool adds bodies in between.
+    // every body is still its own allocation, so bodies never move and pointers to them stay valid
+    void reserve(size_t count) {
+        size_t newBodies = count > bodies.size() ? count - bodies.size() : 0;
+        vertexPool.reserve(vertexPool.size() + newBodies*VertexVector<DVec2>::inlineCapacity);
+        bodies.reserve(count);
+        denseToSlot.reserve(count);
+        slots.reserve(count);
+    }
+
+    void clear() {
+        while (!bodies.empty()) {
+            remove(getHandle(bodies.size() - 1));
+        }
+    }
+
+    // changes whenever a body is added or removed
+    uint64_t getVersion() const { return version; }
+
+    size_t size() const { return bodies.size(); }
+    bool empty() const { return bodies.empty(); }
+    Polygon* operator[](size_t denseIndex) const { return bodies[denseIndex].get(); }
+
+    std::vector<std::unique_ptr<Polygon>>::iterator begin() { return bodies.begin(); }
+    std::vector<std::unique_ptr<Polygon>>::iterator end() { return bodies.end(); }
+
+private:
+    static const uint32_t noSlot = UINT32_MAX;
+
+    struct Slot {
+        uint32_t generation;
+        uint32_t denseIndex;  // next free slot while the slot is unused
+    };
+
+    std::vector<std::unique_ptr<Polygon>> bodies;
+    std::vector<uint32_t> denseToSlot;
+    std::vector<Slot> slots;
+    uint32_t freeHead = noSlot;
+    uint64_t version = 0;
+
+    BodyHandle insert(std::unique_ptr<Polygon> body) {
+        uint32_t index;
+        if (freeHead != noSlot) {
+            index = freeHead;
+            freeHead = slots[index].denseIndex;
+        } else {
+            index = static_cast<uint32_t>(slots.size());
+            slots.push_back({1, 0});
+        }
+        slots[index].denseIndex = static_cast<uint32_t>(bodies.size());
+        bodies.push_back(std::move(body));
+        denseToSlot.push_back(index);
+        version++;
+        return {index, slots[index].generation};
+    }
+};
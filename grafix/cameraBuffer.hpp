@@ -0,0 +1,56 @@
+#pragma once
+#include "utils.hpp"
+
+#include <algorithm>
+#include <glad/glad.h>
+
+// the camera matrix in a uniform buffer that every program reads through the Camera block at binding point 0.
+// it is only uploaded when the matrix changes, drawing a frame with the same camera sets no uniforms
+class CameraBuffer {
+public:
+    static const GLuint binding = 0;
+
+    CameraBuffer() = default;
+    CameraBuffer(const CameraBuffer&) = delete;
+    CameraBuffer& operator=(const CameraBuffer&) = delete;
+
+    // takes the matrix row by row, returns whether it changed
+    bool update(const GLfloat cameraMatrix[9]) {
+        if (ubo != 0 && std::equal(matrix, matrix + 9, cameraMatrix)) {
+            return false;
+        }
+        std::copy(cameraMatrix, cameraMatrix + 9, matrix);
+
+        // std140 stores a mat3 as three columns padded to vec4
+        GLfloat data[12] = {};
+        for (int column = 0; column < 3; column++) {
+            for (int row = 0; row < 3; row++) {
+                data[4*column + row] = cameraMatrix[3*row + column];
+            }
+        }
+
+        if (ubo == 0) {
+            glGenBuffers(1, &ubo);
+            glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(data), data, GL_DYNAMIC_DRAW);
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo);
+        } else {
+            glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), data);
+        }
+        glCheck();
+        return true;
+    }
+
+    // must be called while the gl context still exists
+    void releaseBuffers() {
+        glDeleteBuffers(1, &ubo);
+        ubo = 0;
+    }
+
+private:
+    GLuint ubo = 0;
+    GLfloat matrix[9] = {};
+};
+
+CameraBuffer cameraBuffer;
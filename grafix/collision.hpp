@@ -1,16 +1,11 @@
 #include "polygon.hpp"
 #include "vector2.hpp"
 #include "utils.hpp"
+#include "frameArena.hpp"
 
 #include <array>
 #include <algorithm>
 
-struct PartialCollisionData {
-    double collisionDepth;
-    Polygon* leftPoly;
-    Polygon* rightPoly;
-};
-
 struct CollisionData {
     bool colliding;
     double collisionDepth;
@@ -42,7 +37,7 @@ inline double getPolyCircleCollisionDepth(Polygon& poly, DVec2 cMid, double radi
 }
 
 inline bool pointInPolygon(DVec2 &point, Polygon &polygon) {
-	for (DVec2& normal: polygon.normals) {
+	for (DVec2& normal: polygon.normals()) {
 		if (getPolyCircleCollisionDepth(polygon, point, 0, normal) < 0) {
 			return false;
         }
@@ -54,7 +49,7 @@ inline bool compareAngles(const DVec2 & a, const DVec2 & b) {
     return a.getAngle() < b.getAngle();
 }
 
-DVec2 getPolygonMid(std::vector<DVec2> vertexPoints) {
+DVec2 getPolygonMid(Slice<const DVec2> vertexPoints) {
 	size_t n = vertexPoints.size();
 
     if (n == 1) {
@@ -78,26 +73,27 @@ DVec2 getPolygonMid(std::vector<DVec2> vertexPoints) {
 	return midpoint/totalArea;
 }
 
-inline DVec2 getCollisionPoint(Polygon* leftPoly, Polygon* rightPoly) {
-	// get all collision polygon vertex points
-	std::vector<DVec2> colypolyVertexPoints;
+inline DVec2 getCollisionPoint(Polygon* leftPoly, Polygon* rightPoly, FrameArena& arena) {
+	// get all collision polygon vertex points, there can't be more than one per vertex and one per edge pair
+	ArenaVector<DVec2> colypolyVertexPoints(arena);
+	colypolyVertexPoints.reserve(leftPoly->degree + rightPoly->degree + leftPoly->degree*rightPoly->degree);
 
 	// point in poly 
-	for (DVec2& point: leftPoly->points) {
+	for (DVec2& point: leftPoly->points()) {
 		if (pointInPolygon(point, *rightPoly)) {
 			colypolyVertexPoints.push_back(point);
         }
     }
 
-	for (DVec2& point: rightPoly->points) {
+	for (DVec2& point: rightPoly->points()) {
 		if (pointInPolygon(point, *leftPoly)) {
 			colypolyVertexPoints.push_back(point);
         }
     }
 
 	// edges colliding
-	for (DEdge& edge1: leftPoly->edges) {
-		for (DEdge& edge2: rightPoly->edges) {
+	for (DEdge& edge1: leftPoly->edges()) {
+		for (DEdge& edge2: rightPoly->edges()) {
 			DVec2 P1 = edge1.start;
 			DVec2 r1 = edge1.end - edge1.start;
 			DVec2 P2 = edge2.start;
@@ -135,41 +131,75 @@ inline DVec2 getCollisionPoint(Polygon* leftPoly, Polygon* rightPoly) {
 	std::sort(colypolyVertexPoints.begin(), colypolyVertexPoints.end(), compareAngles);
 
 	// the center of the collision polygon is the point where the collision occurred
-	DVec2 collisionPoint = getPolygonMid(colypolyVertexPoints);
+	DVec2 collisionPoint = getPolygonMid({colypolyVertexPoints.data(), colypolyVertexPoints.size()});
     collisionPoint += pseudoMid;
 
 	return collisionPoint;
 }
 
-inline PartialCollisionData getCollisionDepth(Polygon& poly1, Polygon& poly2, DVec2 normal) {
-    Polygon* leftPoly;
-    Polygon* rightPoly;
-
+// the separating axis loop, with both vertex counts known at compile time so the projections are inlined
+template<size_t N1, size_t N2>
+inline CollisionData findCollision(Polygon& poly1, Polygon& poly2, const ArenaVector<DVec2>& normals, FrameArena& arena) {
+    const DVec2* points1 = poly1.points().first;
+    const DVec2* points2 = poly2.points().first;
     DVec2 betweenVec = poly2.mid - poly1.mid;
-    double between = betweenVec.dot(normal);
-    if (between < 0) {
-        between *= -1;
-        leftPoly = &poly2;
-        rightPoly = &poly1;
+
+    // collision vector points from rightPoly to leftPoly
+    double minCollisionDepth = Infinity;
+    DVec2 collisionVector;
+    Polygon* finalLeftPoly;
+    Polygon* finalRightPoly;
+    for (const DVec2& normal : normals) {
+        // the polygon further along the normal is the right one
+        bool swapped = betweenVec.dot(normal) < 0;
+        double collisionDepth = swapped ?
+            PolygonKernels<N2>::getMaxVal(points2, poly2.degree, normal) - PolygonKernels<N1>::getMinVal(points1, poly1.degree, normal) :
+            PolygonKernels<N1>::getMaxVal(points1, poly1.degree, normal) - PolygonKernels<N2>::getMinVal(points2, poly2.degree, normal);
+        Polygon* leftPoly = swapped ? &poly2 : &poly1;
+        Polygon* rightPoly = swapped ? &poly1 : &poly2;
+
+        if (collisionDepth < 0) {
+            return {false, -1, normal, {0, 0}, leftPoly, rightPoly};
+        }
+        else if (collisionDepth < minCollisionDepth) {
+            minCollisionDepth = collisionDepth;
+            collisionVector = normal;
+            finalLeftPoly = leftPoly;
+            finalRightPoly = rightPoly;
+        }
     }
-    else {
-        leftPoly = &poly1;
-        rightPoly = &poly2;
+    DVec2 collisionPoint = getCollisionPoint(finalLeftPoly, finalRightPoly, arena);
+    if (std::isnan(collisionPoint.x)) {
+        print("this worked");
+        // i guess the polygons are not coliding after all
+        return {false, -1, collisionVector, {0, 0}, finalLeftPoly, finalRightPoly};
     }
-    double maxLeftVal = leftPoly->getMaxVal(normal);
-    double minRightVal = rightPoly->getMinVal(normal);
 
-    double collisionDepth = maxLeftVal - minRightVal;
+    return {true, minCollisionDepth, collisionVector, collisionPoint, finalLeftPoly, finalRightPoly};
+}
 
-    return {collisionDepth, leftPoly, rightPoly};
+// picks the second polygon's kernels, the same vertex counts as getKernelTable
+template<size_t N1>
+inline CollisionData findCollision(Polygon& poly1, Polygon& poly2, const ArenaVector<DVec2>& normals, FrameArena& arena) {
+    switch (poly2.degree) {
+        case 3: return findCollision<N1, 3>(poly1, poly2, normals, arena);
+        case 4: return findCollision<N1, 4>(poly1, poly2, normals, arena);
+        case 6: return findCollision<N1, 6>(poly1, poly2, normals, arena);
+        default: return findCollision<N1, 0>(poly1, poly2, normals, arena);
+    }
 }
 
-inline CollisionData isColliding(Polygon& poly1, Polygon& poly2) {
-    std::vector<DVec2> allNormals(poly1.normals);
-    allNormals.insert(allNormals.end(), poly2.normals.begin(), poly2.normals.end());
+inline CollisionData isColliding(Polygon& poly1, Polygon& poly2, FrameArena& arena) {
+    Slice<DVec2> normals1 = poly1.normals();
+    Slice<DVec2> normals2 = poly2.normals();
+    ArenaVector<DVec2> allNormals(arena);
+    allNormals.reserve(normals1.size() + normals2.size());
+    allNormals.insert(allNormals.end(), normals1.begin(), normals1.end());
+    allNormals.insert(allNormals.end(), normals2.begin(), normals2.end());
 
     // get unique normals, normals that don't point in the same (or opposite) direction
-    std::vector<DVec2> normals;
+    ArenaVector<DVec2> normals(arena);
+    normals.reserve(allNormals.size());
     for (DVec2& normal : allNormals) {
         bool duplicate = false;
         for (DVec2& uniqueNormal : normals) {
@@ -183,31 +213,11 @@ inline CollisionData isColliding(Polygon& poly1, Polygon& poly2) {
         }
     }
 
-    // collision vector points from rightPoly to leftPoly
-    double minCollisionDepth = Infinity;
-    DVec2 collisionVector;
-    Polygon* finalLeftPoly;
-    Polygon* finalRightPoly;
-    for (DVec2& normal : normals) {
-        PartialCollisionData data = getCollisionDepth(poly1, poly2, normal);
-        double collisionDepth = data.collisionDepth;
-
-        if (collisionDepth < 0) {
-            return {false, -1, normal, {0, 0}, data.leftPoly, data.rightPoly};
-        }
-        else if (collisionDepth < minCollisionDepth) {
-            minCollisionDepth = collisionDepth;
-            collisionVector = normal;
-            finalLeftPoly = data.leftPoly;
-            finalRightPoly = data.rightPoly;
-        }
-    }
-    DVec2 collisionPoint = getCollisionPoint(finalLeftPoly, finalRightPoly);
-    if (std::isnan(collisionPoint.x)) {
-        print("this worked");
-        // i guess the polygons are not coliding after all
-        return {false, -1, collisionVector, {0, 0}, finalLeftPoly, finalRightPoly};
+    // the kernels are picked once per pair instead of once per projection
+    switch (poly1.degree) {
+        case 3: return findCollision<3>(poly1, poly2, normals, arena);
+        case 4: return findCollision<4>(poly1, poly2, normals, arena);
+        case 6: return findCollision<6>(poly1, poly2, normals, arena);
+        default: return findCollision<0>(poly1, poly2, normals, arena);
     }
-
-    return {true, minCollisionDepth, collisionVector, collisionPoint, finalLeftPoly, finalRightPoly};
 }
\ No newline at end of file
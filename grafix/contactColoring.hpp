@@ -0,0 +1,118 @@
+#pragma once
+#include "bodyPool.hpp"
+#include "jobSystem.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// splits contacts into colors so that no two contacts of one color touch the same body,
+// every color can then be solved in parallel without atomics or locks.
+// static bodies are never written to by a solver, so any number of contacts of a color may touch them
+class ContactColoring {
+public:
+    static const size_t maxColors = 64;
+
+    // the contacts of color c are order[start[c]] .. order[start[c+1]-1]
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> start;
+
+    // contacts that didn't fit into maxColors colors, these have to be solved one after another
+    std::vector<uint32_t> leftover;
+
+    size_t colorCount() const {
+        return start.empty() ? 0 : start.size() - 1;
+    }
+
+    // colors are handed out greedily in contact order, so the coloring only depends on the contacts
+    template<typename Contact>
+    void build(const std::vector<Contact>& contacts, const BodyPool& bodies) {
+        usedColors.assign(bodies.size(), 0);
+        colors.resize(contacts.size());
+        leftover.clear();
+
+        size_t usedColorCount = 0;
+        std::vector<uint32_t>& counts = start;
+        counts.assign(maxColors + 1, 0);
+        for (uint32_t c = 0; c < contacts.size(); c++) {
+            colors[c] = noColor;
+            if (!contacts[c].colliding) {
+                continue;
+            }
+            uint64_t used = getUsedColors(bodies, contacts[c].left) | getUsedColors(bodies, contacts[c].right);
+            if (used == ~uint64_t(0)) {
+                leftover.push_back(c);
+                continue;
+            }
+            uint32_t color = lowestFreeColor(used);
+            colors[c] = color;
+            markUsed(bodies, contacts[c].left, color);
+            markUsed(bodies, contacts[c].right, color);
+            counts[color + 1]++;
+            usedColorCount = std::max<size_t>(usedColorCount, color + 1);
+        }
+
+        counts.resize(usedColorCount + 1);
+        for (size_t color = 0; color < usedColorCount; color++) {
+            start[color + 1] += start[color];
+        }
+        order.resize(start.back());
+        next.assign(start.begin(), start.end() - 1);
+        for (uint32_t c = 0; c < contacts.size(); c++) {
+            if (colors[c] != noColor) {
+                order[next[colors[c]]++] = c;
+            }
+        }
+    }
+
+    // fn(contact, thread) for every colored contact, the colors run one after another and the contacts
+    // of a color in parallel, then the leftovers on the calling thread
+    template<typename Function>
+    void solve(JobSystem* jobs, size_t batchSize, Function fn) {
+        for (size_t color = 0; color < colorCount(); color++) {
+            size_t first = start[color];
+            size_t count = start[color + 1] - first;
+            auto solveBatch = [this, first, &fn](size_t begin, size_t end, size_t thread) {
+                for (size_t i = begin; i < end; i++) {
+                    fn(order[first + i], thread);
+                }
+            };
+            if (jobs && count > batchSize) {
+                jobs->parallelFor(count, batchSize, solveBatch);
+            } else {
+                solveBatch(0, count, 0);
+            }
+        }
+        for (uint32_t c : leftover) {
+            fn(c, 0);
+        }
+    }
+
+private:
+    static const uint32_t noColor = UINT32_MAX;
+
+    std::vector<uint64_t> usedColors;
+    std::vector<uint32_t> colors;
+    std::vector<uint32_t> next;
+
+    static bool isStatic(const BodyPool& bodies, uint32_t body) {
+        return bodies[body]->immovable && bodies[body]->imrotatable;
+    }
+
+    uint64_t getUsedColors(const BodyPool& bodies, uint32_t body) const {
+        return isStatic(bodies, body) ? 0 : usedColors[body];
+    }
+
+    void markUsed(const BodyPool& bodies, uint32_t body, uint32_t color) {
+        if (!isStatic(bodies, body)) {
+            usedColors[body] |= uint64_t(1) << color;
+        }
+    }
+
+    static uint32_t lowestFreeColor(uint64_t used) {
+        uint32_t color = 0;
+        while (used & (uint64_t(1) << color)) {
+            color++;
+        }
+        return color;
+    }
+};
@@ -0,0 +1,187 @@
+#include "entities.hpp"
+#include "physics.hpp"
+#include "world.hpp"
+#include "utils.hpp"
+
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+// checks what deterministic mode guarantees: two worlds with the same bodies under the same handles,
+// but in a different order in the pool, end up bitwise identical at every thread count.
+// the second world gets its order from removing bodies and adding them again, which keeps their handles.
+// also checks that colored contacts step identically at every thread count and that no color
+// has two contacts on the same dynamic body, including a body with more contacts than there are colors.
+// usage: grafixDeterminism [steps]
+// returns 0 if every check passed
+
+const int gridSize = 12;
+
+Polygon createBody(int i) {
+    DVec2 pos(-3.5 + (i % gridSize)*0.6, -1.5 + (i / gridSize)*0.25);
+    GLcolor color = {0, 0, 0, 1};
+    Polygon body = i % 3 ? createRect(pos, 0.3, 0.2, 1, color) : createRegularPolygon(pos, 6, 0.12f, 1, color);
+    body.vel = {std::sin(i*1.7)*3, std::cos(i*2.3)*3};
+    body.rotVel = std::sin(i*0.9)*2;
+    return body;
+}
+
+// the box and the bodies, with every third body removed and added again when shuffled
+void buildScene(World& world, bool shuffled) {
+    getBox(world.bodies, 2);
+    std::vector<BodyHandle> handles;
+    for (int i = 0; i < gridSize*gridSize; i++) {
+        handles.push_back(world.bodies.add(createBody(i)));
+    }
+    if (shuffled) {
+        for (int i = 0; i < gridSize*gridSize; i += 3) {
+            world.bodies.remove(handles[i]);
+            world.bodies.add(createBody(i));
+        }
+    }
+}
+
+// the state of every body, by handle index
+std::vector<double> getState(const BodyPool& bodies) {
+    std::vector<double> state;
+    for (size_t d = 0; d < bodies.size(); d++) {
+        size_t index = bodies.getHandle(d).index;
+        state.resize(std::max(state.size(), (index + 1)*6));
+        const Polygon* body = bodies[d];
+        double values[6] = {body->mid.x, body->mid.y, body->vel.x, body->vel.y, body->rotation, body->rotVel};
+        std::copy(values, values + 6, state.begin() + index*6);
+    }
+    return state;
+}
+
+bool isBitwiseEqual(const std::vector<double>& a, const std::vector<double>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()*sizeof(double)) == 0;
+}
+
+std::vector<double> simulate(bool deterministic, bool shuffled, size_t threadCount, int steps, bool colorContacts = false) {
+    JobSystem jobs(threadCount);
+    World world;
+    world.jobs = &jobs;
+    world.deterministic = deterministic;
+    world.colorContacts = colorContacts;
+    buildScene(world, shuffled);
+    for (int s = 0; s < steps; s++) {
+        physicsUpdate(world, 1e-3);
+    }
+    return getState(world.bodies);
+}
+
+// no two contacts of a color touch the same dynamic body,
+// and every colliding contact is either in one color or left over, once
+template<typename Contact>
+bool isValidColoring(const ContactColoring& coloring, const std::vector<Contact>& contacts, const BodyPool& bodies) {
+    std::vector<size_t> lastColor(bodies.size(), SIZE_MAX);
+    std::vector<int> uses(contacts.size(), 0);
+    for (size_t color = 0; color < coloring.colorCount(); color++) {
+        for (uint32_t i = coloring.start[color]; i < coloring.start[color + 1]; i++) {
+            uint32_t c = coloring.order[i];
+            uses[c]++;
+            for (uint32_t body : {contacts[c].left, contacts[c].right}) {
+                if (bodies[body]->immovable && bodies[body]->imrotatable) {
+                    continue;
+                }
+                if (lastColor[body] == color) {
+                    return false;
+                }
+                lastColor[body] = color;
+            }
+        }
+    }
+    for (uint32_t c : coloring.leftover) {
+        uses[c]++;
+    }
+    for (size_t c = 0; c < contacts.size(); c++) {
+        if (uses[c] != (contacts[c].colliding ? 1 : 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the coloring of every step of the scene
+bool checkSceneColoring(int steps) {
+    World world;
+    world.colorContacts = true;
+    buildScene(world, false);
+    for (int s = 0; s < steps; s++) {
+        physicsUpdate(world, 1e-3);
+        if (!isValidColoring(world.coloring, world.contacts, world.bodies)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct TestContact {
+    bool colliding;
+    uint32_t left;
+    uint32_t right;
+};
+
+// one dynamic body touching more bodies than there are colors, and a static body touching all of them.
+// the contacts past the last color have to be left over
+bool checkHubColoring() {
+    BodyPool bodies;
+    GLcolor color = {0, 0, 0, 1};
+    size_t spokes = ContactColoring::maxColors + 36;
+    for (size_t i = 0; i < spokes + 1; i++) {
+        bodies.add(createRect({0, 0}, 0.1, 0.1, 1, color));
+    }
+    uint32_t wall = static_cast<uint32_t>(bodies.size());
+    bodies.add(createRect({0, 0}, 0.1, 0.1, 1, color, true, true));
+
+    std::vector<TestContact> contacts;
+    for (uint32_t i = 1; i <= spokes; i++) {
+        contacts.push_back({true, 0, i});
+        contacts.push_back({true, i, wall});
+        contacts.push_back({false, i, 0});
+    }
+    ContactColoring coloring;
+    coloring.build(contacts, bodies);
+    return isValidColoring(coloring, contacts, bodies) && coloring.leftover.size() == spokes - ContactColoring::maxColors;
+}
+
+int main(int argc, char** argv) {
+    int steps = argc > 1 ? std::atoi(argv[1]) : 2000;
+    size_t threadCounts[] = {1, 2, 4, 8};
+
+    bool passed = true;
+    std::vector<double> reference = simulate(true, false, 1, steps);
+    std::vector<double> defaultReference = simulate(false, false, 1, steps);
+    for (size_t threadCount : threadCounts) {
+        bool ordered = isBitwiseEqual(simulate(true, false, threadCount, steps), reference);
+        bool shuffled = isBitwiseEqual(simulate(true, true, threadCount, steps), reference);
+        bool defaultMode = isBitwiseEqual(simulate(false, false, threadCount, steps), defaultReference);
+        print(threadCount, "threads: deterministic", ordered ? "ok" : "FAILED",
+            "shuffled pool", shuffled ? "ok" : "FAILED", "default mode", defaultMode ? "ok" : "FAILED");
+        passed &= ordered && shuffled && defaultMode;
+    }
+
+    // without removals the modes agree, with them only deterministic mode is independent of the pool order
+    bool sameWithoutRemovals = isBitwiseEqual(defaultReference, reference);
+    bool defaultShuffled = isBitwiseEqual(simulate(false, true, 1, steps), reference);
+    print("default mode equals deterministic mode without removals:", sameWithoutRemovals ? "ok" : "FAILED");
+    print("default mode with a shuffled pool:", defaultShuffled ? "same" : "different");
+    passed &= sameWithoutRemovals;
+
+    std::vector<double> colorReference = simulate(false, false, 1, steps, true);
+    for (size_t threadCount : threadCounts) {
+        bool colored = isBitwiseEqual(simulate(false, false, threadCount, steps, true), colorReference);
+        print(threadCount, "threads: colored contacts", colored ? "ok" : "FAILED");
+        passed &= colored;
+    }
+    bool sceneColoring = checkSceneColoring(steps);
+    bool hubColoring = checkHubColoring();
+    print("no color touches a dynamic body twice, scene:", sceneColoring ? "ok" : "FAILED",
+        "more contacts than colors:", hubColoring ? "ok" : "FAILED");
+    passed &= sceneColoring && hubColoring;
+
+    print(passed ? "passed" : "FAILED");
+    return passed ? 0 : 1;
+}
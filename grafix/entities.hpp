@@ -3,30 +3,31 @@
 #include "player.hpp"
 #include "utils.hpp"
 #include "vector2.hpp"
+#include "bodyPool.hpp"
 
 #include <vector>
 
-void getBox(std::vector<Polygon>& entities, double contentScale) {
+void getBox(BodyPool& entities, double contentScale) {
     double boxSize = 0.2;
     double boxLeft = -2 * contentScale;
     double boxRight = 2 * contentScale;
     double boxTop = contentScale;
     double boxBottom = -contentScale;
-    entities.push_back(
+    entities.add(
         createRect({ 0, boxTop }, boxRight - boxLeft, boxSize, 1, { 0, 0, 0, 1 }, true, true)
     );
-    entities.push_back(
+    entities.add(
         createRect({ 0, boxBottom }, boxRight - boxLeft, boxSize, 1, { 0, 0, 0, 1 }, true, true)
     );
-    entities.push_back(
+    entities.add(
         createRect({ boxLeft, 0 }, boxSize, boxTop - boxBottom, 1, { 0, 0, 0, 1 }, true, true)
     );
-    entities.push_back(
+    entities.add(
         createRect({ boxRight, 0 }, boxSize, boxTop - boxBottom, 1, { 0, 0, 0, 1 }, true, true)
     );
 }
 
-void getSlope(std::vector<Polygon>& entities, double contentScale) {
+void getSlope(BodyPool& entities, double contentScale) {
     DVec2 pos = {-3.85, -2};
     double x0 = 0;
     double y0 = 3;
@@ -51,18 +52,19 @@ void getSlope(std::vector<Polygon>& entities, double contentScale) {
             vertices[i] -= mid;
         }
 
-        entities.push_back(Polygon({x0 + pos.x, cy + pos.y}, vertices, 1, {1, 0, 1, 0}, true, true));
+        entities.emplace<Polygon>(DVec2(x0 + pos.x, cy + pos.y), vertices, 1, GLcolor{1, 0, 1, 0}, true, true);
         x0 += dx;
     }
 }
 
-inline Player getPlayerAndEntities(std::vector<Polygon>& entities, double contentScale) {
+inline BodyHandle getPlayerAndEntities(BodyPool& entities, double contentScale) {
+    GLcolor playerColor = { 0.4, 0.8, 0.2, 1 };
+    BodyHandle player = entities.emplace<Player>(DVec2(0, 0), 0.8, 0.8, 1, playerColor);
+
     getSlope(entities, contentScale);
-    Polygon hexagon = createRegularPolygon({ 2, -0.5 }, 6, 0.8, 1, { 0.1, 0.3, 0.7, 1 });
-    entities.push_back(hexagon);
+    entities.add(createRegularPolygon({ 2, -0.5 }, 6, 0.8, 1, { 0.1, 0.3, 0.7, 1 }));
     getBox(entities, contentScale);
-    
-    GLcolor playerColor = { 0.4, 0.8, 0.2, 1 };
-    return Player({ 0, 0 }, 0.8, 0.8, 1, playerColor);
+
+    return player;
 }
 
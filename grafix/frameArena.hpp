@@ -0,0 +1,109 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// linear allocator for memory that only lives for one physics step,
+// allocating is a pointer bump and everything is freed at once by reset()
+class FrameArena {
+public:
+    explicit FrameArena(size_t blockSize = 1 << 16): blockSize(blockSize) {}
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    FrameArena(FrameArena&&) = default;
+    FrameArena& operator=(FrameArena&&) = default;
+
+    void* allocate(size_t size, size_t alignment) {
+        if (current < blocks.size()) {
+            uintptr_t base = reinterpret_cast<uintptr_t>(blocks[current].data.get());
+            size_t start = (base + offset + alignment - 1) / alignment * alignment - base;
+            if (start + size <= blocks[current].size) {
+                offset = start + size;
+                return blocks[current].data.get() + start;
+            }
+        }
+        nextBlock(size + alignment);
+        return allocate(size, alignment);
+    }
+
+    template<typename T>
+    T* allocate(size_t count) {
+        return static_cast<T*>(allocate(count*sizeof(T), alignof(T)));
+    }
+
+    // free everything, if the last step needed more than one block they are merged so the next one doesn't
+    void reset() {
+        if (blocks.size() > 1) {
+            size_t total = 0;
+            for (Block& block : blocks) {
+                total += block.size;
+            }
+            blocks.clear();
+            blocks.push_back(Block(total));
+        }
+        current = 0;
+        offset = 0;
+    }
+
+    size_t capacity() const {
+        size_t total = 0;
+        for (const Block& block : blocks) {
+            total += block.size;
+        }
+        return total;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+        explicit Block(size_t size): data(new unsigned char[size]), size(size) {}
+    };
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t current = 0;
+    size_t offset = 0;
+
+    void nextBlock(size_t minSize) {
+        if (current < blocks.size()) {
+            current++;
+        }
+        while (current < blocks.size() && blocks[current].size < minSize) {
+            current++;
+        }
+        if (current == blocks.size()) {
+            blocks.push_back(Block(minSize > blockSize ? minSize : blockSize));
+        }
+        offset = 0;
+    }
+};
+
+// lets standard containers allocate from a frame arena, deallocation does nothing
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    FrameArena* arena;
+
+    ArenaAllocator(FrameArena& arena): arena(&arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other): arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        return arena->allocate<T>(count);
+    }
+
+    void deallocate(T*, size_t) {}
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,93 @@
+#pragma once
+#include "utils.hpp"
+
+#include <cstdio>
+#include <cstddef>
+#include <functional>
+#include <glad/glad.h>
+
+// reads finished frames back to the cpu through two pixel buffers. reading a frame only starts a copy into one of them,
+// it is mapped one frame later, so the copy overlaps with drawing the next frame instead of stalling the pipeline
+class FrameReader {
+public:
+    // gets the rgb pixels of a frame, rows from the bottom up like gl stores them
+    using Sink = std::function<void(const unsigned char* pixels, int width, int height)>;
+
+    FrameReader(int width, int height, Sink sink): width(width), height(height), sink(sink) {
+        size_t size = getFrameSize();
+        glGenBuffers(2, pbos);
+        for (GLuint pbo : pbos) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glCheck();
+    }
+
+    FrameReader(const FrameReader&) = delete;
+    FrameReader& operator=(const FrameReader&) = delete;
+
+    // start reading the bound read framebuffer and hand the previous frame to the sink
+    void read() {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[current]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, (void *)0);
+        glCheck();
+        pending[current] = true;
+
+        current = 1 - current;
+        deliver(current);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // hand the last frame to the sink, call after the last read
+    void finish() {
+        deliver(1 - current);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // must be called while the gl context still exists
+    void releaseBuffers() {
+        glDeleteBuffers(2, pbos);
+        pbos[0] = 0;
+        pbos[1] = 0;
+    }
+
+private:
+    int width;
+    int height;
+    Sink sink;
+    GLuint pbos[2] = {};
+    bool pending[2] = {};
+    int current = 0;
+
+    size_t getFrameSize() const {
+        return static_cast<size_t>(width)*height*3;
+    }
+
+    void deliver(int i) {
+        if (!pending[i]) {
+            return;
+        }
+        pending[i] = false;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        const unsigned char* pixels = static_cast<const unsigned char*>(
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, getFrameSize(), GL_MAP_READ_BIT)
+        );
+        if (pixels != nullptr) {
+            sink(pixels, width, height);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glCheck();
+    }
+};
+
+// writes a frame as a binary ppm, flipped so the first row is the top one.
+// several frames written to one stream can be piped into ffmpeg with -f image2pipe -c:v ppm
+inline void writePpm(std::FILE* file, const unsigned char* pixels, int width, int height) {
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    size_t rowSize = static_cast<size_t>(width)*3;
+    for (int y = height - 1; y >= 0; y--) {
+        std::fwrite(pixels + y*rowSize, 1, rowSize, file);
+    }
+}
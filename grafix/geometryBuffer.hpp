@@ -0,0 +1,150 @@
+#pragma once
+#include "vector2.hpp"
+#include "utils.hpp"
+
+#include <vector>
+#include <map>
+#include <utility>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+#include <glad/glad.h>
+
+// where a shape's geometry sits in the geometry buffer
+struct GeometryRange {
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0;
+    GLsizei indexCount = 0;
+    GLsizei vertexCount = 0;
+    unsigned int generation = 0;  // 0 means never uploaded
+
+    // byte offset of the first index, what the draw calls take as their indices pointer
+    const void* indexOffset() const {
+        return reinterpret_cast<const void*>(static_cast<uintptr_t>(firstIndex)*sizeof(GLuint));
+    }
+};
+
+// the vertices and indices of every drawn shape in one vertex buffer and one index buffer,
+// so draws only need the base vertex and first index of a shape instead of binding its own buffers.
+// the range of a dead shape is released and handed to the next shape with as many vertices and indices,
+// shapes of one degree all have the same size so the buffers stop growing once the set of degrees is stable.
+// only used on the thread that owns the gl context, except release
+class GeometryBuffer {
+public:
+    GLuint vbo = 0;  // 2 floats per vertex
+    GLuint ebo = 0;  // indices relative to the shape's base vertex
+
+    // put a shape's geometry into a released range of the same size, or append it.
+    // the buffers grow by copying on the gpu
+    GeometryRange add(const DVec2* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount) {
+        GeometryRange range;
+        if (!takeReleased(vertexCount, indexCount, range)) {
+            reserve(vertexUsed + vertexCount, indexUsed + indexCount);
+            range.baseVertex = static_cast<GLint>(vertexUsed);
+            range.firstIndex = static_cast<GLuint>(indexUsed);
+            range.indexCount = static_cast<GLsizei>(indexCount);
+            range.vertexCount = static_cast<GLsizei>(vertexCount);
+            range.generation = generation;
+            vertexUsed += vertexCount;
+            indexUsed += indexCount;
+        }
+
+        std::vector<GLfloat> vertexData(vertexCount*2);
+        for (size_t i = 0; i < vertexCount; i++) {
+            vertexData[i*2] = static_cast<GLfloat>(vertices[i].x);
+            vertexData[i*2+1] = static_cast<GLfloat>(vertices[i].y);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.baseVertex*2*sizeof(GLfloat), vertexData.size()*sizeof(GLfloat), vertexData.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstIndex*sizeof(GLuint), indexCount*sizeof(GLuint), indices);
+        glCheck();
+        return range;
+    }
+
+    // give back the range of a shape that is no longer drawn. shapes die on whichever thread drops them last,
+    // so this only does bookkeeping and may be called from any thread. draws already issued still see the old
+    // geometry, gl orders the upload of the next shape after them
+    void release(const GeometryRange& range) {
+        std::lock_guard<std::mutex> lock(releasedMutex);
+        if (range.generation != generation) {
+            return;
+        }
+        released[{range.vertexCount, range.indexCount}].push_back(range);
+    }
+
+    // whether a range still refers to these buffers
+    bool isCurrent(const GeometryRange& range) const {
+        return range.generation == generation;
+    }
+
+    // must be called while the gl context still exists, every range becomes stale
+    void releaseBuffers() {
+        if (vbo != 0) {
+            glDeleteBuffers(1, &vbo);
+            glDeleteBuffers(1, &ebo);
+        }
+        vbo = 0;
+        ebo = 0;
+        vertexCapacity = 0;
+        indexCapacity = 0;
+        vertexUsed = 0;
+        indexUsed = 0;
+        std::lock_guard<std::mutex> lock(releasedMutex);
+        released.clear();
+        generation++;
+    }
+
+private:
+    size_t vertexCapacity = 0;
+    size_t indexCapacity = 0;
+    size_t vertexUsed = 0;
+    size_t indexUsed = 0;
+    unsigned int generation = 1;
+
+    // released ranges by vertex and index count
+    std::map<std::pair<GLsizei, GLsizei>, std::vector<GeometryRange>> released;
+    std::mutex releasedMutex;
+
+    bool takeReleased(size_t vertexCount, size_t indexCount, GeometryRange& range) {
+        std::lock_guard<std::mutex> lock(releasedMutex);
+        auto found = released.find({static_cast<GLsizei>(vertexCount), static_cast<GLsizei>(indexCount)});
+        if (found == released.end() || found->second.empty()) {
+            return false;
+        }
+        range = found->second.back();
+        found->second.pop_back();
+        return true;
+    }
+
+    void reserve(size_t vertexCount, size_t indexCount) {
+        if (vertexCount > vertexCapacity) {
+            size_t newCapacity = std::max<size_t>({vertexCount, vertexCapacity*2, 1024});
+            grow(vbo, vertexUsed*2*sizeof(GLfloat), newCapacity*2*sizeof(GLfloat));
+            vertexCapacity = newCapacity;
+        }
+        if (indexCount > indexCapacity) {
+            size_t newCapacity = std::max<size_t>({indexCount, indexCapacity*2, 4096});
+            grow(ebo, indexUsed*sizeof(GLuint), newCapacity*sizeof(GLuint));
+            indexCapacity = newCapacity;
+        }
+    }
+
+    // replace buffer by a bigger one that starts with the used bytes of the old one.
+    // the copy binding points are used so no vertex array state is touched
+    static void grow(GLuint& buffer, size_t usedBytes, size_t newBytes) {
+        GLuint newBuffer;
+        glGenBuffers(1, &newBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+        if (buffer != 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = newBuffer;
+        glCheck();
+    }
+};
+
+GeometryBuffer geometryBuffer;
@@ -1,5 +1,10 @@
 #pragma once
 #include "utils.hpp"
+#include "player.hpp"
+#include "hitbox.hpp"
+
+#include <cstdlib>
+#include <algorithm>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -10,25 +15,6 @@ void processInput(GLFWwindow* window, Player& player);
 
 double contentScale = 2;
 
-const char* vertexShaderSource = R"glsl(
-    #version 430 core
-    layout (location = 0) in vec2 vertex;
-    layout (location = 1) uniform mat3 transform;
-    layout (location = 2) uniform mat3 camera;
-    void main() {
-        gl_Position = vec4((camera*transform*vec3(vertex.xy, 1)).xy, 0, 1);
-    }
-)glsl";
-
-const char* fragmentShaderSource = R"glsl(
-    #version 430 core
-    out vec4 FragColor;
-    layout (location = 3) uniform vec4 color;
-    void main() {
-        FragColor = color;
-    }
-)glsl";
-
 inline GLuint compileShader(const char* shaderSource, GLenum type) {
     GLuint shader = glCreateShader(type);
     glShaderSource(shader, 1, &shaderSource, NULL);
@@ -48,13 +34,75 @@ inline GLuint compileShader(const char* shaderSource, GLenum type) {
     return shader;
 }
 
+inline GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource) {
+    // compile shaders
+    GLint vertexShader = compileShader(vertexSource, GL_VERTEX_SHADER);
+    GLint fragmentShader = compileShader(fragmentSource, GL_FRAGMENT_SHADER);
+
+    // link shaders
+    GLint shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+    glLinkProgram(shaderProgram);
+    glCheck();
+
+    // check for linking errors
+    GLint success;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    glCheck();
+
+    return shaderProgram;
+}
+
+inline const char* glDebugTypeString(GLenum type) {
+    switch (type) {
+        case GL_DEBUG_TYPE_ERROR: return "error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+        case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+        case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+        default: return "other";
+    }
+}
+
+inline void APIENTRY glDebugCallback(
+    GLenum /*source*/, GLenum type, GLuint id, GLenum /*severity*/, GLsizei /*length*/, const GLchar* message, const void* /*userParam*/
+) {
+    print("gl", glDebugTypeString(type), id, ":", message);
+}
+
+// the driver reports errors through a callback, so nothing has to poll glGetError.
+// this also works without a debug context, drivers just report less there.
+// debug builds get the messages synchronously, from inside the call that caused them
+inline void enableDebugOutput() {
+    if (!(GLAD_GL_VERSION_4_3 || GLAD_GL_KHR_debug)) {
+        return;
+    }
+    glEnable(GL_DEBUG_OUTPUT);
+#ifndef NDEBUG
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
+    glDebugMessageCallback(glDebugCallback, nullptr);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+}
+
 inline GLFWwindow* glInit() {
     // initialize and configure
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // debug contexts can be slower, release builds still get errors through the debug output without one
+#ifndef NDEBUG
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
+#endif
 
     // create window
     const double screenScale = 0.75;
@@ -74,39 +122,70 @@ inline GLFWwindow* glInit() {
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         std::cout << "Failed to initialize GLAD" << std::endl;
     }
+    enableDebugOutput();
 
-    GLuint vao;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-    glCheck();
-
-    // compile shaders
-    GLint vertexShader = compileShader(vertexShaderSource, GL_VERTEX_SHADER);
-    GLint fragmentShader = compileShader(fragmentShaderSource, GL_FRAGMENT_SHADER);
+    glfwSetScrollCallback(window, scrollCallback);
 
-    // link shaders
-    GLint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    glCheck();
+    return window;
+}
 
-    // check for linking errors
-    GLint success;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+// a context without a visible window, for drawing into offscreen framebuffers.
+// on linux without a display glfw 3.4 can use its null platform, with a context from osmesa
+inline GLFWwindow* glInitOffscreen() {
+#if defined(GLFW_PLATFORM_NULL) && defined(__linux__)
+    if (std::getenv("DISPLAY") == nullptr && std::getenv("WAYLAND_DISPLAY") == nullptr) {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
     }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    glCheck();
+#endif
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifndef NDEBUG
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, false);
+#ifdef GLFW_PLATFORM_NULL
+    if (glfwGetPlatform() == GLFW_PLATFORM_NULL) {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
+#endif
 
-    glUseProgram(shaderProgram);
-    glCheck();
+    GLFWwindow* window = glfwCreateWindow(1, 1, "GRAFIX", NULL, NULL);
+    if (window == NULL) {
+        std::cout << "Failed to create offscreen GLFW context" << std::endl;
+        glfwTerminate();
+        return NULL;
+    }
+    glfwMakeContextCurrent(window);
 
-    glfwSetScrollCallback(window, scrollCallback);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+    }
+    enableDebugOutput();
 
     return window;
-}
\ No newline at end of file
+}
+
+// the camera matrix for a viewport, squished so that the aspect ratio is 1:1. returns the area the camera sees
+inline Hitbox getCamera(int width, int height, GLfloat cameraMatrix[9]) {
+    GLfloat sx, sy;
+    if (height > width) {
+        sx = 1;
+        sy = static_cast<float>(width)/height;
+    } else {
+        sx = static_cast<float>(height)/width;
+        sy = 1;
+    }
+
+    GLfloat matrix[9] = {
+        static_cast<GLfloat>(sx/contentScale), 0, 0,
+        0, static_cast<GLfloat>(sy/contentScale), 0,
+        0, 0, 1
+    };
+    std::copy(matrix, matrix + 9, cameraMatrix);
+
+    double halfWidth = contentScale/sx;
+    double halfHeight = contentScale/sy;
+    return Hitbox(DVec2(-halfWidth, -halfHeight), 2*halfWidth, 2*halfHeight);
+}
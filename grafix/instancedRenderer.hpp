@@ -0,0 +1,263 @@
+#pragma once
+#include "renderState.hpp"
+#include "shape.hpp"
+#include "glUtils.hpp"
+#include "streamBuffer.hpp"
+#include "staticMesh.hpp"
+#include "cameraBuffer.hpp"
+#include "utils.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <glad/glad.h>
+
+const char* instancedVertexShaderSource = R"glsl(
+    #version 430 core
+    layout (location = 0) in vec2 vertex;
+    layout (location = 1) in vec4 transform;  // x, y, cos, sin
+    layout (location = 2) in vec4 instanceColor;
+    layout (std140, binding = 0) uniform Camera {
+        mat3 camera;
+    };
+    out vec4 color;
+    void main() {
+        vec2 rotated = vec2(
+            transform.z*vertex.x - transform.w*vertex.y,
+            transform.w*vertex.x + transform.z*vertex.y
+        );
+        gl_Position = vec4((camera*vec3(rotated + transform.xy, 1)).xy, 0, 1);
+        color = instanceColor;
+    }
+)glsl";
+
+const char* instancedFragmentShaderSource = R"glsl(
+    #version 430 core
+    in vec4 color;
+    out vec4 FragColor;
+    void main() {
+        FragColor = color;
+    }
+)glsl";
+
+// draws every body of a shape with one instanced draw call. the geometry of a shape is uploaded once,
+// the transforms and colors of all bodies go into one instance buffer that is refilled every frame.
+// with persistent mapping the instances are written straight into gpu visible memory,
+// otherwise they are copied into an orphaned buffer. static bodies are baked into one mesh instead.
+// with multi draw indirect all shapes are drawn with one call, from draw commands written next to the instances
+class InstancedRenderer {
+public:
+    InstancedRenderer():
+        persistent(StreamBuffer::isSupported()),
+        multiDraw(GLAD_GL_VERSION_4_3 || (GLAD_GL_VERSION_4_2 && GLAD_GL_ARB_multi_draw_indirect)) {
+        program = createShaderProgram(instancedVertexShaderSource, instancedFragmentShaderSource);
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &instanceVbo);
+        glCheck();
+    }
+
+    InstancedRenderer(const InstancedRenderer&) = delete;
+    InstancedRenderer& operator=(const InstancedRenderer&) = delete;
+
+    // the camera comes from cameraBuffer, leaves the renderer's program bound
+    void draw(const RenderState& state) {
+        glUseProgram(program);
+        if (!staticMesh.isCurrent(state)) {
+            staticMesh.bake(state);
+        }
+        staticMesh.draw();
+
+        // with no moving body on screen there is nothing to upload, the instance buffer may not even exist yet
+        const std::vector<BodySnapshot>& bodies = state.bodies;
+        buildBatches(bodies);
+        if (batches.empty()) {
+            return;
+        }
+
+        // upload new shapes first, the draw commands need their ranges and this may replace the geometry buffers
+        for (const Batch& batch : batches) {
+            batch.shape->getGeometry();
+        }
+
+        // the instances and then the draw commands of this frame, in one block of the instance buffer
+        size_t instanceBytes = bodies.size()*sizeof(Instance);
+        size_t commandBytes = multiDraw ? batches.size()*sizeof(DrawCommand) : 0;
+        size_t instanceOffset = 0;
+        GLuint instanceBuffer = instanceVbo;
+        unsigned char* target;
+        if (persistent) {
+            target = static_cast<unsigned char*>(stream.map(instanceBytes + commandBytes));
+            instanceOffset = stream.getOffset();
+            instanceBuffer = stream.getBuffer();
+        } else {
+            staging.resize((instanceBytes + commandBytes + sizeof(Instance) - 1) / sizeof(Instance));
+            target = reinterpret_cast<unsigned char*>(staging.data());
+        }
+        writeInstances(bodies, reinterpret_cast<Instance*>(target));
+        if (multiDraw) {
+            writeCommands(reinterpret_cast<DrawCommand*>(target + instanceBytes));
+        }
+        if (!persistent) {
+            upload(instanceBytes + commandBytes);
+        }
+
+        glBindVertexArray(vao);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribDivisor(1, 1);
+        glVertexAttribDivisor(2, 1);
+        glCheck();
+
+        // every shape is in the same buffers, they are bound once per frame
+        glBindBuffer(GL_ARRAY_BUFFER, geometryBuffer.vbo);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometryBuffer.ebo);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glCheck();
+
+        if (multiDraw) {
+            // one call for every shape, each command's base instance picks its instances
+            setInstanceAttributes(instanceOffset);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, instanceBuffer);
+            glMultiDrawElementsIndirect(
+                GL_TRIANGLES, GL_UNSIGNED_INT, (void *)(instanceOffset + instanceBytes),
+                static_cast<GLsizei>(batches.size()), 0
+            );
+            glCheck();
+        } else {
+            for (const Batch& batch : batches) {
+                const GeometryRange& range = batch.shape->getGeometry();
+
+                // the attributes start at the batch's first instance, base instance needs gl 4.2
+                setInstanceAttributes(instanceOffset + batch.first*sizeof(Instance));
+                glDrawElementsInstancedBaseVertex(
+                    GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+                    range.indexOffset(), static_cast<GLsizei>(batch.count), range.baseVertex
+                );
+                glCheck();
+            }
+        }
+
+        if (persistent) {
+            stream.fence();
+        }
+    }
+
+    // must be called while the gl context still exists
+    void releaseBuffers() {
+        stream.releaseBuffers();
+        staticMesh.releaseBuffers();
+        glDeleteBuffers(1, &instanceVbo);
+        glDeleteVertexArrays(1, &vao);
+        glDeleteProgram(program);
+        instanceVbo = 0;
+        vao = 0;
+        program = 0;
+        capacity = 0;
+    }
+
+private:
+    struct Instance {
+        GLfloat x;
+        GLfloat y;
+        GLfloat cosθ;
+        GLfloat sinθ;
+        GLcolor color;
+    };
+
+    // the layout glMultiDrawElementsIndirect reads
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // the instances of one shape are instances[first] .. instances[first + count - 1]
+    struct Batch {
+        const Shape* shape;
+        size_t first;
+        size_t count;
+    };
+
+    GLuint program = 0;
+    GLuint vao = 0;
+
+    bool persistent;
+    bool multiDraw;
+    StreamBuffer stream;
+    StaticMesh staticMesh;
+
+    // only used without persistent mapping
+    GLuint instanceVbo = 0;
+    size_t capacity = 0;  // bytes the buffer has room for
+    std::vector<Instance> staging;
+
+    std::vector<Batch> batches;
+    std::unordered_map<const Shape*, size_t> batchOfShape;
+
+    // count the bodies of every shape and give each shape its range of instances
+    void buildBatches(const std::vector<BodySnapshot>& bodies) {
+        batches.clear();
+        batchOfShape.clear();
+        for (const BodySnapshot& snapshot : bodies) {
+            auto inserted = batchOfShape.emplace(snapshot.shape.get(), batches.size());
+            if (inserted.second) {
+                batches.push_back({snapshot.shape.get(), 0, 0});
+            }
+            batches[inserted.first->second].count++;
+        }
+
+        size_t first = 0;
+        for (Batch& batch : batches) {
+            batch.first = first;
+            first += batch.count;
+            batch.count = 0;
+        }
+    }
+
+    // put every body into the range of its shape, so no sort is needed
+    void writeInstances(const std::vector<BodySnapshot>& bodies, Instance* target) {
+        for (const BodySnapshot& snapshot : bodies) {
+            Batch& batch = batches[batchOfShape[snapshot.shape.get()]];
+            target[batch.first + batch.count++] = {
+                static_cast<GLfloat>(snapshot.mid.x),
+                static_cast<GLfloat>(snapshot.mid.y),
+                static_cast<GLfloat>(snapshot.cosθ),
+                static_cast<GLfloat>(snapshot.sinθ),
+                snapshot.color
+            };
+        }
+    }
+
+    void writeCommands(DrawCommand* target) {
+        for (size_t i = 0; i < batches.size(); i++) {
+            const GeometryRange& range = batches[i].shape->getGeometry();
+            target[i] = {
+                static_cast<GLuint>(range.indexCount),
+                static_cast<GLuint>(batches[i].count),
+                range.firstIndex,
+                range.baseVertex,
+                static_cast<GLuint>(batches[i].first)
+            };
+        }
+    }
+
+    void setInstanceAttributes(size_t offset) {
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void *)(offset + offsetof(Instance, x)));
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void *)(offset + offsetof(Instance, color)));
+    }
+
+    // the buffer is orphaned before it is refilled, so the driver doesn't wait for last frame's draws
+    void upload(size_t size) {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+        if (size > capacity) {
+            capacity = std::max(size, capacity*2);
+        }
+        glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, staging.data());
+        glCheck();
+    }
+};
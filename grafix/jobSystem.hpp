@@ -0,0 +1,337 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define cpuRelax() _mm_pause()
+#else
+#define cpuRelax() std::this_thread::yield()
+#endif
+
+// a set of tasks and the order they have to run in.
+// tasks must be added after the tasks they depend on
+class TaskGraph {
+public:
+    using TaskId = size_t;
+
+    // tasks [first, last) that were added together
+    struct TaskRange {
+        TaskId first;
+        TaskId last;
+    };
+
+    // fn gets the index of the thread running it
+    TaskId add(std::function<void(size_t)> fn) {
+        if (count == tasks.size()) {
+            tasks.emplace_back(new Task());
+        }
+        Task& task = *tasks[count];
+        task.fn = std::move(fn);
+        task.successors.clear();
+        task.dependencies = 0;
+        return count++;
+    }
+
+    // fn(begin, end, thread) for every chunk of chunkSize indices in [0, count).
+    // the chunks only depend on chunkSize, so as long as fn only writes to its own indices
+    // the result is the same as running it serially, on any number of threads
+    template<typename Function>
+    TaskRange addParallelFor(size_t count, size_t chunkSize, Function fn) {
+        TaskRange range = {this->count, this->count};
+        for (size_t begin = 0; begin < count; begin += chunkSize) {
+            size_t end = std::min(begin + chunkSize, count);
+            range.last = add([fn, begin, end](size_t thread) { fn(begin, end, thread); });
+            range.last++;
+        }
+        return range;
+    }
+
+    // after won't start before before is done
+    void precede(TaskId before, TaskId after) {
+        tasks[before]->successors.push_back(after);
+        tasks[after]->dependencies++;
+    }
+
+    void precede(TaskRange before, TaskId after) {
+        for (TaskId task = before.first; task < before.last; task++) {
+            precede(task, after);
+        }
+    }
+
+    void precede(TaskId before, TaskRange after) {
+        for (TaskId task = after.first; task < after.last; task++) {
+            precede(before, task);
+        }
+    }
+
+    // every task of after waits for the task of before with the same position, for ranges over the same chunks
+    void precedeEach(TaskRange before, TaskRange after) {
+        for (size_t i = 0; i < before.last - before.first; i++) {
+            precede(before.first + i, after.first + i);
+        }
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // forget all tasks, but keep their memory for the next graph
+    void clear() {
+        for (size_t i = 0; i < count; i++) {
+            tasks[i]->fn = nullptr;
+        }
+        count = 0;
+    }
+
+    // run every task on the calling thread
+    void runInline() {
+        for (size_t i = 0; i < count; i++) {
+            tasks[i]->fn(0);
+        }
+    }
+
+private:
+    friend class JobSystem;
+
+    struct Task {
+        std::function<void(size_t)> fn;
+        std::vector<TaskId> successors;
+        size_t dependencies;
+        std::atomic<size_t> pending;
+    };
+
+    std::vector<std::unique_ptr<Task>> tasks;
+    size_t count = 0;
+};
+
+struct JobSystemConfig {
+    // threads including the one calling run()
+    size_t threadCount = std::thread::hardware_concurrency();
+
+    // pin worker i to cpus[(i-1) % cpus.size()], or to cpu i-1 if the list is empty.
+    // the thread calling run() is left alone
+    bool pinThreads = false;
+    std::vector<int> cpus;
+
+    // how long an idle worker spins before it goes to sleep. the phases of a step are a few microseconds apart,
+    // spinning through those gaps saves a wake up each time, the gaps between steps at 200 Hz are slept through
+    std::chrono::microseconds spinTime{50};
+};
+
+// runs task graphs on a fixed set of threads. every thread has its own queue,
+// threads that run out of work steal the oldest tasks from the others
+class JobSystem {
+public:
+    explicit JobSystem(size_t threadCount = std::thread::hardware_concurrency()): JobSystem(configFor(threadCount)) {}
+
+    explicit JobSystem(const JobSystemConfig& config): spinTime(config.spinTime) {
+        size_t threadCount = std::max<size_t>(config.threadCount, 1);
+        // the thread calling run() does its share of the work, so it is counted as thread 0
+        for (size_t i = 0; i < threadCount; i++) {
+            queues.emplace_back(new Queue());
+        }
+        for (size_t i = 1; i < threadCount; i++) {
+            workers.emplace_back([this, i]() { workerLoop(i); });
+            if (config.pinThreads) {
+                int cpu = config.cpus.empty() ? static_cast<int>(i - 1) : config.cpus[(i - 1) % config.cpus.size()];
+                pinThread(workers.back(), cpu);
+            }
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleeping.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    size_t size() const {
+        return queues.size();
+    }
+
+    // runs fn(begin, end, thread) over [0, count) in chunks of chunkSize and waits for it
+    template<typename Function>
+    void parallelFor(size_t count, size_t chunkSize, Function fn) {
+        forGraph.clear();
+        forGraph.addParallelFor(count, chunkSize, fn);
+        run(forGraph);
+    }
+
+    // runs every task of the graph and returns when all of them are done
+    void run(TaskGraph& graph) {
+        if (graph.size() == 0) {
+            return;
+        }
+        current = &graph;
+        remaining = graph.size();
+        for (size_t i = 0; i < graph.size(); i++) {
+            graph.tasks[i]->pending = graph.tasks[i]->dependencies;
+        }
+        for (size_t i = 0; i < graph.size(); i++) {
+            if (graph.tasks[i]->dependencies == 0) {
+                push(0, i);
+            }
+        }
+
+        while (remaining != 0) {
+            size_t task;
+            if (pop(0, task)) {
+                execute(0, task);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        current = nullptr;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<TaskGraph::TaskId> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    TaskGraph* current = nullptr;
+    TaskGraph forGraph;
+    std::atomic<size_t> remaining{0};
+    std::atomic<size_t> queued{0};
+
+    std::chrono::microseconds spinTime;
+    std::mutex sleepMutex;
+    std::condition_variable sleeping;
+    std::atomic<size_t> sleepers{0};
+    bool stopping = false;
+
+    static JobSystemConfig configFor(size_t threadCount) {
+        JobSystemConfig config;
+        config.threadCount = threadCount;
+        return config;
+    }
+
+    // a failed pin only costs performance, so it is ignored
+    static void pinThread(std::thread& thread, int cpu) {
+#if defined(_WIN32)
+        SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+        (void)thread;
+        (void)cpu;
+#endif
+    }
+
+    void push(size_t thread, TaskGraph::TaskId task) {
+        {
+            std::lock_guard<std::mutex> lock(queues[thread]->mutex);
+            queues[thread]->tasks.push_back(task);
+        }
+        queued++;
+        // spinning workers see the task without a notification. a worker going to sleep checks queued
+        // after counting itself as a sleeper, so either it sees this task or we see it
+        if (sleepers != 0) {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+            }
+            sleeping.notify_one();
+        }
+    }
+
+    // newest task of our own queue first, otherwise the oldest task of someone else's
+    bool pop(size_t thread, TaskGraph::TaskId& task) {
+        if (queued == 0) {
+            return false;
+        }
+        for (size_t i = 0; i < queues.size(); i++) {
+            Queue& queue = *queues[(thread + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                if (i == 0) {
+                    task = queue.tasks.back();
+                    queue.tasks.pop_back();
+                } else {
+                    task = queue.tasks.front();
+                    queue.tasks.pop_front();
+                }
+                queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void execute(size_t thread, TaskGraph::TaskId id) {
+        TaskGraph::Task& task = *current->tasks[id];
+        task.fn(thread);
+        for (TaskGraph::TaskId successor : task.successors) {
+            if (--current->tasks[successor]->pending == 0) {
+                push(thread, successor);
+            }
+        }
+        remaining--;
+    }
+
+    // wait for spinTime for a task to show up, returns whether one did
+    bool spin() {
+        auto end = std::chrono::steady_clock::now() + spinTime;
+        do {
+            for (int i = 0; i < 64; i++) {
+                if (queued != 0) {
+                    return true;
+                }
+                cpuRelax();
+            }
+        } while (std::chrono::steady_clock::now() < end);
+        return false;
+    }
+
+    void workerLoop(size_t thread) {
+        while (true) {
+            size_t task;
+            if (pop(thread, task)) {
+                execute(thread, task);
+                continue;
+            }
+            if (spin()) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepers++;
+            sleeping.wait(lock, [this]() { return stopping || queued != 0; });
+            sleepers--;
+            if (stopping) {
+                return;
+            }
+        }
+    }
+};
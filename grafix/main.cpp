@@ -3,7 +3,11 @@
 #include "entities.hpp"
 #include "utils.hpp"
 #include "physics.hpp"
+#include "world.hpp"
+#include "physicsThread.hpp"
 #include "glUtils.hpp"
+#include "instancedRenderer.hpp"
+#include "cameraBuffer.hpp"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -11,17 +15,30 @@
 #include <vector>
 #include <iostream>
 
+// the camera is only recomputed by the callbacks, which glfwPollEvents runs on this thread
+GLfloat cameraMatrix[9];
+Hitbox cameraView;
+bool cameraChanged = false;
+
+void updateCamera(int width, int height) {
+    // a minimized window has no size, the last camera is kept
+    if (width == 0 || height == 0) {
+        return;
+    }
+    cameraView = getCamera(width, height, cameraMatrix);
+    cameraChanged = true;
+}
+
 int main() {
     GLFWwindow* window = glInit();
+    InstancedRenderer renderer;
 
-    std::vector<Polygon> entities;
-    Player player = getPlayerAndEntities(entities, contentScale);
+    World world;
+    BodyHandle playerHandle = getPlayerAndEntities(world.bodies, contentScale);
+    Player& player = static_cast<Player&>(*world.bodies.get(playerHandle));
 
-    std::vector<Polygon*> entityPs;
-    entityPs.push_back(&player);
-    for (size_t i = 0; i < entities.size(); i++) {
-        entityPs.push_back(&entities[i]);
-    }
+    JobSystem jobs;
+    world.jobs = &jobs;
 
     int avgCounter = 30;
     int frameCount = 0;
@@ -30,6 +47,13 @@ int main() {
     double avgdt = dt*avgCounter;
     double time = getTime() - dt;
 
+    // physics runs at a fixed rate on its own thread from here on, the world must not be touched by this thread anymore
+    PhysicsThread physics(world, dtGoal);
+
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    updateCamera(framebufferWidth, framebufferHeight);
+
     // render loop
     while (!glfwWindowShouldClose(window)) {
         // calculate dt and print it
@@ -52,37 +76,16 @@ int main() {
         glClear(GL_COLOR_BUFFER_BIT);
         glCheck();
 
-        // squish screen so that the aspect ratio is 1:1
-        GLfloat sx, sy;
-        int windowHeight, windowWidth;
-        glfwGetWindowSize(window, &windowWidth, &windowHeight);
-        if (windowHeight > windowWidth) {
-            sx = 1;
-            sy = static_cast<float>(windowWidth)/windowHeight;
-        } else {
-            sx = static_cast<float>(windowHeight)/windowWidth;
-            sy = 1;
-        }
-
-        // create and upload camera matrix
-        GLfloat cameraMatrix[9] = {
-            sx/contentScale, 0, 0,
-            0, sy/contentScale, 0,
-            0, 0, 1
-        };
-        glUniformMatrix3fv(2, 1, GL_TRUE, cameraMatrix);
-        glCheck();
-
-        double repetitions = std::ceil(dt / dtGoal);
-        for (size_t i = 0; i < repetitions; i++) {
-            double pdt = dt / repetitions;
-            physicsUpdate(entityPs, pdt);
+        // the camera is only uploaded and the view only published when the window size or zoom changed.
+        // only the bodies the camera sees are published and drawn
+        if (cameraChanged) {
+            cameraBuffer.update(cameraMatrix);
+            physics.setView(cameraView);
+            cameraChanged = false;
         }
 
         // draw
-        for (Polygon* entity: entityPs) {
-            entity->draw();
-        }
+        renderer.draw(physics.latest());
 
         // swap buffers
         glfwSwapInterval(1);
@@ -91,6 +94,10 @@ int main() {
     }
 
     // terminate
+    physics.stop();
+    renderer.releaseBuffers();
+    geometryBuffer.releaseBuffers();
+    cameraBuffer.releaseBuffers();
     glfwTerminate();
     return 0;
 }
@@ -98,6 +105,10 @@ int main() {
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
     double speed = 1.0/16;
     contentScale -= yoffset*contentScale*speed;
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    updateCamera(width, height);
 }
 
 
@@ -134,4 +145,5 @@ void processInput(GLFWwindow *window, Player &player) {
 // resize window
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
     glViewport(0, 0, width, height);
+    updateCamera(width, height);
 }
@@ -0,0 +1,49 @@
+#pragma once
+#include "utils.hpp"
+
+#include <stdexcept>
+#include <glad/glad.h>
+
+// a framebuffer with a color renderbuffer to draw into instead of a window
+class OffscreenTarget {
+public:
+    const int width;
+    const int height;
+
+    OffscreenTarget(int width, int height): width(width), height(height) {
+        glGenRenderbuffers(1, &colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("offscreen framebuffer is incomplete");
+        }
+        glCheck();
+    }
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    // draws and reads go to this target from here on
+    void bind() const {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+        glCheck();
+    }
+
+    // must be called while the gl context still exists
+    void releaseBuffers() {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        fbo = 0;
+        colorBuffer = 0;
+    }
+
+private:
+    GLuint fbo = 0;
+    GLuint colorBuffer = 0;
+};
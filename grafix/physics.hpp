@@ -2,83 +2,321 @@
 #include "polygon.hpp"
 #include "collision.hpp"
 #include "vector2.hpp"
+#include "frameArena.hpp"
+#include "world.hpp"
+#include "jobSystem.hpp"
 
 #include <array>
+#include <algorithm>
 
-void physicsUpdate(std::vector<Polygon*> entityPs, double pdt) {
-    // collision handeling
-    for (size_t i = 0; i < entityPs.size(); i++) {
-        for (size_t j = i+1; j < entityPs.size(); j++) {
-            if (!(entityPs[i]->immovable*entityPs[i]->imrotatable*entityPs[j]->immovable*entityPs[j]->imrotatable)) {
-                if (entityPs[i]->hitbox.collides(entityPs[j]->hitbox)) {
-                    CollisionData collisionData = isColliding(*entityPs[i], *entityPs[j]);
-                    if (collisionData.colliding) {
-                        Polygon* left = collisionData.leftPoly;
-                        Polygon* right = collisionData.rightPoly;
-                        DVec2 collisionVector = collisionData.collisionVector;
-                        DVec2 leftCollisionVector = collisionData.collisionPoint - left->mid;
-                        DVec2 rightCollisionVector = collisionData.collisionPoint - right->mid;
-
-                        DVec2 leftTranslationVelocity = left->vel;
-                        DVec2 leftRotationVelocity = left->rotVel*leftCollisionVector.getOrthogonal();
-                        DVec2 leftVelocity = leftTranslationVelocity + leftRotationVelocity;
-
-                        DVec2 rightTranslationVelocity = right->vel;
-                        DVec2 rightRotationVelocity = right->rotVel*rightCollisionVector.getOrthogonal();
-                        DVec2 rightVelocity = rightTranslationVelocity + rightRotationVelocity;
-                        DVec2 collisionVelocity = leftVelocity - rightVelocity;
-
-                        // spring force
-                        double k = 10000;
-                        DVec2 springForce = -k*collisionVector*collisionData.collisionDepth;
-                
-                        // damping force
-                        double d = 80;
-                        double speed = collisionVelocity.dot(collisionVector);
-                        DVec2 dampingForce = -d*collisionVector*speed;
-
-                        // friction force
-                        DVec2 frictionForce(0, 0);
-                        if (collisionVelocity.getSquaredLength() != 0) {
-                            double mu = 0.5;
-                            frictionForce = -mu*collisionVector.getLength()*collisionVelocity/collisionVelocity.getLength();
-                        }
-
-                        DVec2 totalForce = springForce + dampingForce + frictionForce;
-
-                        // translation
-                        left->force += totalForce;
-                        right->force += -totalForce;
-
-                        // rotation
-                        left->tourqe += leftCollisionVector.cross(totalForce);
-                        right->tourqe += rightCollisionVector.cross(-totalForce);
-                    }
+// the work of a step is split into chunks of this many bodies
+const size_t bodiesPerChunk = 64;
+
+// narrowphase batches per thread, more batches than threads lets idle threads steal the expensive ones
+const size_t batchesPerThread = 4;
+
+// contacts of one color per task when solving by color
+const size_t contactsPerBatch = 256;
+
+// the force on left from a contact, right gets the opposite force
+inline void getContactForce(CollisionData& collisionData, const PhysicsParams& params, DVec2& totalForce, double& leftTourqe, double& rightTourqe) {
+    Polygon* left = collisionData.leftPoly;
+    Polygon* right = collisionData.rightPoly;
+    DVec2 collisionVector = collisionData.collisionVector;
+    DVec2 leftCollisionVector = collisionData.collisionPoint - left->mid;
+    DVec2 rightCollisionVector = collisionData.collisionPoint - right->mid;
+
+    DVec2 leftTranslationVelocity = left->vel;
+    DVec2 leftRotationVelocity = left->rotVel*leftCollisionVector.getOrthogonal();
+    DVec2 leftVelocity = leftTranslationVelocity + leftRotationVelocity;
+
+    DVec2 rightTranslationVelocity = right->vel;
+    DVec2 rightRotationVelocity = right->rotVel*rightCollisionVector.getOrthogonal();
+    DVec2 rightVelocity = rightTranslationVelocity + rightRotationVelocity;
+    DVec2 collisionVelocity = leftVelocity - rightVelocity;
+
+    // spring force
+    double k = params.k;
+    DVec2 springForce = -k*collisionVector*collisionData.collisionDepth;
+
+    // damping force
+    double d = params.d;
+    double speed = collisionVelocity.dot(collisionVector);
+    DVec2 dampingForce = -d*collisionVector*speed;
+
+    // friction force
+    DVec2 frictionForce(0, 0);
+    if (collisionVelocity.getSquaredLength() != 0) {
+        double mu = params.mu;
+        frictionForce = -mu*collisionVector.getLength()*collisionVelocity/collisionVelocity.getLength();
+    }
+
+    totalForce = springForce + dampingForce + frictionForce;
+
+    // rotation
+    leftTourqe = leftCollisionVector.cross(totalForce);
+    rightTourqe = rightCollisionVector.cross(-totalForce);
+}
+
+inline void applyAirResistance(Polygon* entity, const PhysicsParams& params) {
+    // translation drag
+    DVec2 vel = entity->vel;
+    if (vel.getSquaredLength() != 0) {
+        double Cd = params.Cd;
+        double lineArea = entity->getLength(vel.getNormalized().getOrthogonal());
+        DVec2 dragForce = -Cd*lineArea*vel;
+        entity->force += dragForce;
+    }
+
+    // rotation drag
+    double Cd = params.rotationCd;
+    double rotVel = entity->rotVel;
+    double radius = entity->radius;
+    entity->tourqe += -2.0/3*Cd*rotVel*radius*radius*radius;
+}
+
+struct StepContext {
+    World& world;
+    double pdt;
+    size_t chunkCount;
+    size_t batchCount;
+};
+
+inline bool isPairable(Polygon* a, Polygon* b) {
+    return !(a->immovable && a->imrotatable && b->immovable && b->imrotatable);
+}
+
+// pairs of bodies in rows [begin, end) whose hitboxes overlap. the candidates of a body come from the spatial grid,
+// they are sorted by index, so the pairs are the same and in the same order as when testing every body against every other
+inline void findPairs(StepContext& step, size_t begin, size_t end, size_t thread) {
+    BodyPool& entityPs = step.world.bodies;
+    const SpatialGrid& grid = step.world.grid;
+    std::vector<BodyPair>& pairs = step.world.chunkPairs[begin/bodiesPerChunk];
+    pairs.clear();
+    ArenaVector<uint32_t> candidates(step.world.threadArenas[thread]);
+    for (uint32_t i = static_cast<uint32_t>(begin); i < end; i++) {
+        Polygon* body = entityPs[i];
+        if (grid.isLarge(i)) {
+            // the hitbox covers too many cells, testing everything is cheaper
+            for (uint32_t j = i+1; j < entityPs.size(); j++) {
+                if (isPairable(body, entityPs[j]) && body->hitbox.collides(entityPs[j]->hitbox)) {
+                    pairs.push_back({i, j});
                 }
             }
+            continue;
         }
+        candidates.clear();
+        grid.query(body->hitbox, candidates);
+        for (uint32_t j : candidates) {
+            if (j > i && isPairable(body, entityPs[j]) && body->hitbox.collides(entityPs[j]->hitbox)) {
+                pairs.push_back({i, j});
+            }
+        }
+    }
+}
+
+// join the pairs of all chunks, in chunk order so the pair order doesn't depend on scheduling.
+// in deterministic mode the pairs are put in body id order, so they don't depend on where bodies sit in the pool either.
+// contacts are summed per body in pair order, so that is all it takes
+inline void partitionPairs(StepContext& step) {
+    World& world = step.world;
+    world.pairs.clear();
+    for (size_t chunk = 0; chunk < step.chunkCount; chunk++) {
+        world.pairs.insert(world.pairs.end(), world.chunkPairs[chunk].begin(), world.chunkPairs[chunk].end());
     }
-            
-    // air resistance
-    for (Polygon* entity: entityPs) {
-        // translation drag
-        DVec2 vel = entity->vel;
-        if (vel.getSquaredLength() != 0) {
-            double Cd = 0.25;
-            double lineArea = entity->getLength(vel.getNormalized().getOrthogonal());
-            DVec2 dragForce = -Cd*lineArea*vel;
-            entity->force += dragForce;
+    if (world.deterministic) {
+        BodyPool& bodies = world.bodies;
+        for (BodyPair& pair : world.pairs) {
+            if (bodies.getHandle(pair.i).index > bodies.getHandle(pair.j).index) {
+                std::swap(pair.i, pair.j);
+            }
         }
+        std::sort(world.pairs.begin(), world.pairs.end(), [&bodies](const BodyPair& a, const BodyPair& b) {
+            uint32_t ai = bodies.getHandle(a.i).index;
+            uint32_t bi = bodies.getHandle(b.i).index;
+            if (ai != bi) {
+                return ai < bi;
+            }
+            return bodies.getHandle(a.j).index < bodies.getHandle(b.j).index;
+        });
+    }
+    world.contacts.resize(world.pairs.size());
+}
 
-        // rotation drag
-        double Cd = 0.15;
-        double rotVel = entity->rotVel;
-        double radius = entity->radius;
-        entity->tourqe += -2.0/3*Cd*rotVel*radius*radius*radius;
+inline void narrowphase(StepContext& step, size_t batch, size_t thread) {
+    World& world = step.world;
+    BodyPool& entityPs = world.bodies;
+    size_t begin = world.pairs.size()*batch/step.batchCount;
+    size_t end = world.pairs.size()*(batch+1)/step.batchCount;
+    for (size_t p = begin; p < end; p++) {
+        BodyPair pair = world.pairs[p];
+        ContactResult& contact = world.contacts[p];
+        CollisionData collisionData = isColliding(*entityPs[pair.i], *entityPs[pair.j], world.threadArenas[thread]);
+        contact.colliding = collisionData.colliding;
+        if (collisionData.colliding) {
+            contact.left = collisionData.leftPoly == entityPs[pair.i] ? pair.i : pair.j;
+            contact.right = contact.left == pair.i ? pair.j : pair.i;
+            getContactForce(collisionData, world.params, contact.force, contact.leftTourqe, contact.rightTourqe);
+        }
     }
+}
 
-    // update position and velocity
-    for (Polygon* entity: entityPs) {
-        entity->update(pdt);
+// list the contacts of every body in pair order, or color them when they are solved by color
+inline void gatherContacts(StepContext& step) {
+    World& world = step.world;
+    std::vector<uint32_t>& start = world.contactStart;
+    start.assign(world.bodies.size() + 1, 0);
+    if (world.colorContacts) {
+        world.coloring.build(world.contacts, world.bodies);
+        world.bodyContacts.clear();
+        return;
+    }
+    for (ContactResult& contact : world.contacts) {
+        if (contact.colliding) {
+            start[contact.left + 1]++;
+            start[contact.right + 1]++;
+        }
+    }
+    for (size_t i = 0; i < world.bodies.size(); i++) {
+        start[i+1] += start[i];
     }
-}
\ No newline at end of file
+
+    world.bodyContacts.resize(start.back());
+    std::vector<uint32_t>& next = world.contactNext;
+    next.assign(start.begin(), start.end() - 1);
+    for (uint32_t c = 0; c < world.contacts.size(); c++) {
+        ContactResult& contact = world.contacts[c];
+        if (contact.colliding) {
+            world.bodyContacts[next[contact.left]++] = {c, true};
+            world.bodyContacts[next[contact.right]++] = {c, false};
+        }
+    }
+}
+
+// add the contact forces and drag to bodies [begin, end)
+inline void reduceForces(StepContext& step, size_t begin, size_t end) {
+    World& world = step.world;
+    for (size_t i = begin; i < end; i++) {
+        Polygon* entity = world.bodies[i];
+        for (uint32_t k = world.contactStart[i]; k < world.contactStart[i+1]; k++) {
+            BodyContact bodyContact = world.bodyContacts[k];
+            ContactResult& contact = world.contacts[bodyContact.contact];
+            if (bodyContact.left) {
+                entity->force += contact.force;
+                entity->tourqe += contact.leftTourqe;
+            } else {
+                entity->force += -contact.force;
+                entity->tourqe += contact.rightTourqe;
+            }
+        }
+
+        applyAirResistance(entity, world.params);
+    }
+}
+
+// add the force of one contact to both of its bodies, static bodies are left alone.
+// only called for contacts of one color at a time, so no other thread touches these bodies
+inline void applyContact(World& world, uint32_t c) {
+    ContactResult& contact = world.contacts[c];
+    Polygon* left = world.bodies[contact.left];
+    Polygon* right = world.bodies[contact.right];
+    if (!(left->immovable && left->imrotatable)) {
+        left->force += contact.force;
+        left->tourqe += contact.leftTourqe;
+    }
+    if (!(right->immovable && right->imrotatable)) {
+        right->force += -contact.force;
+        right->tourqe += contact.rightTourqe;
+    }
+}
+
+inline void integrate(StepContext& step, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        step.world.bodies[i]->integrate(step.pdt);
+    }
+}
+
+inline void refreshTransforms(StepContext& step, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        step.world.bodies[i]->refresh();
+    }
+}
+
+// bodies only depend on themselves from here, so each chunk goes on as soon as its forces are summed.
+// every body is integrated and refreshed on its own, so this is bit-identical to the serial loop
+inline TaskGraph::TaskRange addIntegration(StepContext& step, TaskGraph& graph) {
+    size_t bodyCount = step.world.bodies.size();
+    TaskGraph::TaskRange reduce = graph.addParallelFor(bodyCount, bodiesPerChunk, [&step](size_t begin, size_t end, size_t) {
+        reduceForces(step, begin, end);
+    });
+    TaskGraph::TaskRange move = graph.addParallelFor(bodyCount, bodiesPerChunk, [&step](size_t begin, size_t end, size_t) {
+        integrate(step, begin, end);
+    });
+    TaskGraph::TaskRange refresh = graph.addParallelFor(bodyCount, bodiesPerChunk, [&step](size_t begin, size_t end, size_t) {
+        refreshTransforms(step, begin, end);
+    });
+    graph.precedeEach(reduce, move);
+    graph.precedeEach(move, refresh);
+    return reduce;
+}
+
+inline void runGraph(World& world) {
+    if (world.jobs) {
+        world.jobs->run(world.graph);
+    } else {
+        world.graph.runInline();
+    }
+}
+
+void physicsUpdate(World& world, double pdt) {
+    size_t threadCount = world.jobs ? world.jobs->size() : 1;
+    StepContext step = {
+        world, pdt,
+        (world.bodies.size() + bodiesPerChunk - 1) / bodiesPerChunk,
+        threadCount*batchesPerThread
+    };
+
+    // everything allocated from the arenas only lives for this step
+    world.threadArenas.resize(threadCount);
+    for (FrameArena& arena : world.threadArenas) {
+        arena.reset();
+    }
+    world.chunkPairs.resize(step.chunkCount);
+
+    // build the task graph of the step, grid -> broadphase -> narrowphase -> forces -> integration -> transforms.
+    // tasks are added after the tasks they depend on, so the graph can also run in order on one thread
+    TaskGraph& graph = world.graph;
+    graph.clear();
+
+    size_t bodyCount = world.bodies.size();
+    TaskGraph::TaskId grid = graph.add([&world](size_t) { world.grid.build(world.bodies); });
+    TaskGraph::TaskRange broadphase = graph.addParallelFor(bodyCount, bodiesPerChunk, [&step](size_t begin, size_t end, size_t thread) {
+        findPairs(step, begin, end, thread);
+    });
+    graph.precede(grid, broadphase);
+    TaskGraph::TaskId partition = graph.add([&step](size_t) { partitionPairs(step); });
+    graph.precede(broadphase, partition);
+
+    // the pair count isn't known yet, so the narrowphase is split into a fixed number of batches
+    TaskGraph::TaskRange narrow = graph.addParallelFor(step.batchCount, 1, [&step](size_t batch, size_t, size_t thread) {
+        narrowphase(step, batch, thread);
+    });
+    graph.precede(partition, narrow);
+    TaskGraph::TaskId gather = graph.add([&step](size_t) { gatherContacts(step); });
+    graph.precede(narrow, gather);
+
+    if (world.colorContacts) {
+        // the colors are solved one after another, so the graph has to stop here
+        runGraph(world);
+        world.coloring.solve(world.jobs, contactsPerBatch, [&world](uint32_t contact, size_t) {
+            applyContact(world, contact);
+        });
+        graph.clear();
+        addIntegration(step, graph);
+    } else {
+        TaskGraph::TaskRange integration = addIntegration(step, graph);
+        graph.precede(gather, integration);
+    }
+
+    runGraph(world);
+}
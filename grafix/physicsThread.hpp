@@ -0,0 +1,92 @@
+#pragma once
+#include "physics.hpp"
+#include "world.hpp"
+#include "renderState.hpp"
+#include "tripleBuffer.hpp"
+#include "utils.hpp"
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+// steps a world at a fixed rate on its own thread and publishes the transforms after every tick,
+// the render thread draws whatever was published last and never waits for physics.
+// once the render thread has set a view, only the moving bodies in it are published
+class PhysicsThread {
+public:
+    // most steps taken in one tick, if physics can't keep up the simulation slows down instead of falling further behind
+    static const int maxStepsPerTick = 8;
+
+    PhysicsThread(World& world, double pdt): world(world), pdt(pdt) {
+        captureRenderState(world, states.writeBuffer());
+        states.publish();
+        thread = std::thread([this]() { run(); });
+    }
+
+    PhysicsThread(const PhysicsThread&) = delete;
+    PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+    ~PhysicsThread() {
+        stop();
+    }
+
+    // finish the current tick and stop stepping
+    void stop() {
+        running = false;
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    // the area the camera sees, moving bodies outside of it are left out of the published states.
+    // only call this from the render thread
+    void setView(const Hitbox& view) {
+        views.writeBuffer() = view;
+        views.publish();
+    }
+
+    // the newest published state, only call this from the render thread
+    const RenderState& latest() {
+        states.update();
+        return states.readBuffer();
+    }
+
+private:
+    World& world;
+    double pdt;
+    TripleBuffer<RenderState> states;
+    TripleBuffer<Hitbox> views;
+    bool hasView = false;
+    std::vector<uint32_t> candidates;
+    std::atomic<bool> running{true};
+    std::thread thread;
+
+    void run() {
+        double nextStep = getTime();
+        while (running) {
+            int steps = 0;
+            while (getTime() >= nextStep && steps < maxStepsPerTick) {
+                physicsUpdate(world, pdt);
+                nextStep += pdt;
+                steps++;
+            }
+            if (steps == maxStepsPerTick) {
+                nextStep = std::max(nextStep, getTime());
+            }
+            if (steps != 0) {
+                hasView |= views.update();
+                if (hasView) {
+                    captureRenderState(world, states.writeBuffer(), views.readBuffer(), candidates);
+                } else {
+                    captureRenderState(world, states.writeBuffer());
+                }
+                states.publish();
+            }
+
+            std::this_thread::sleep_for(std::chrono::duration<double>(nextStep - getTime()));
+        }
+    }
+};
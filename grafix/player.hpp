@@ -3,11 +3,12 @@
 #include "utils.hpp"
 
 #include <GLFW/glfw3.h>
-#include <unordered_map>
+#include <atomic>
 
 class Player : public Polygon {
 public:
-    std::unordered_map<int, bool> keys;
+    // written by the input thread and read by the physics thread
+    std::atomic<bool> keys[GLFW_KEY_LAST + 1] = {};
 
     Player(
         DVec2 pos, double width, double height,
@@ -3,29 +3,27 @@
 #include "vector2.hpp"
 #include "hitbox.hpp"
 #include "utils.hpp"
+#include "vertexPool.hpp"
+#include "shape.hpp"
 
 #include <vector>
 #include <tuple>
+#include <memory>
 #include <cmath>
 #include <glad/glad.h>
 
-struct DEdge {
-    DVec2 start;
-    DVec2 end;
-};
-
 class Polygon {
 public:
-    std::vector<DVec2> vertices;
     double density;
     GLcolor color;
     bool immovable;
     bool imrotatable;
     size_t degree;
 
-    std::vector<DVec2> points;
-    std::vector<DEdge> edges;
-    std::vector<DVec2> normals;
+    // local geometry is shared with every polygon of the same shape,
+    // points, edges and normals are stored in the shared vertex pool
+    std::shared_ptr<const Shape> shape;
+    VertexRange geometry;
 
     double area;
     double mass;
@@ -34,10 +32,6 @@ public:
     DVec2 mid;
     Hitbox hitbox;
 
-    std::vector<GLfloat> vertexData;
-    std::vector<GLuint> indexData;
-    GLuint vbo;  // vertex buffer object
-
     DVec2 force = {0, 0};
     DVec2 acc = {0, 0};
     DVec2 vel = {0, 0};
@@ -49,83 +43,73 @@ public:
     double sinθ = 0;
                          
     Polygon(
-            DVec2 pos, std::vector<DVec2> vertices,
+            DVec2 pos, const std::vector<DVec2>& vertices,
             double density, GLcolor color={0,0,0,1},
             bool immovable=false, bool imrotatable=false
-    ): vertices(vertices), density(density), color(color), immovable(immovable), imrotatable(imrotatable) {
-        degree = vertices.size();
-        points.resize(degree);
-        edges.resize(degree);
-        normals.resize(degree);
+    ): Polygon(pos, shapeCache.get(vertices), density, color, immovable, imrotatable) {}
 
-        setPoints(points, pos);
-        setAreaAndMid(area, mid);
+    Polygon(
+            DVec2 pos, std::shared_ptr<const Shape> shape,
+            double density, GLcolor color={0,0,0,1},
+            bool immovable=false, bool imrotatable=false
+    ): density(density), color(color), immovable(immovable), imrotatable(imrotatable), shape(shape) {
+        degree = shape->degree;
+        geometry = VertexRange(degree);
+
+        setPoints(points(), pos);
+        area = shape->area;
+        mid = pos + shape->centroid;
         mass = area * density;
-        DVec2 dpos = mid - pos;
-        if (dpos.getSquaredLength() > 1e-6) {
+        if (shape->centroid.getSquaredLength() > 1e-6) {
             print("grr");
-            dpos.printSelf();
+            shape->centroid.printSelf();
         }
-        setEdges(edges);
-        setNormals(normals);
+        setEdges(edges());
+        setNormals(normals());
 
-        setMoofin(moofin);
+        moofin = mass * shape->moofinPerMass;
         setHitbox(hitbox);
-        setRadius(radius);
+        radius = shape->radius;
+    }
 
-        vertexData.resize(degree*2);
-        for (size_t i = 0; i < degree; i++) {
-            vertexData[i*2] = static_cast<GLfloat>(vertices[i].x);
-            vertexData[i*2+1] = static_cast<GLfloat>(vertices[i].y);
-        }
+    Polygon(const Polygon&) = default;
+    Polygon(Polygon&&) = default;
+    Polygon& operator=(const Polygon&) = default;
+    Polygon& operator=(Polygon&&) = default;
+    virtual ~Polygon() = default;
 
-        indexData.resize((degree-2)*3);
-        for (size_t i = 0; i < degree-2; i++) {
-            indexData[i*3] = static_cast<GLuint>(0);
-            indexData[i*3+1] = static_cast<GLuint>(i+1);
-            indexData[i*3+2] = static_cast<GLuint>(i+2);
-        }
-
-        glGenBuffers(1, &vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertexData.size()*sizeof(GLfloat), vertexData.data(), GL_STATIC_DRAW);
-        glCheck();
+    void update(double dt) {
+        integrate(dt);
+        refresh();
     }
 
-    void update(double dt) {
+    void integrate(double dt) {
         move(dt);
         step(dt);
-        setPoints(points);
-        setEdges(edges);
-        setNormals(normals);
+    }
+
+    // bring the world space geometry up to date with mid and rotation
+    void refresh() {
+        setPoints(points());
+        setEdges(edges());
+        setNormals(normals());
         setHitbox(hitbox);
     }
 
-    void draw() {
-        // prepare to draw
-        GLfloat fposx = static_cast<GLfloat>(mid.x);
-        GLfloat fposy = static_cast<GLfloat>(mid.y);
-        GLfloat fcosθ = static_cast<GLfloat>(cosθ);
-        GLfloat fsinθ = static_cast<GLfloat>(sinθ);
-        GLfloat transformationMatrix[9] = {
-            fcosθ, -fsinθ, fposx,
-            fsinθ,  fcosθ, fposy,
-             0  ,   0  ,   1
-        };
-        glUniformMatrix3fv(1, 1, GL_TRUE, transformationMatrix);
-        glCheck();
+    Slice<const DVec2> vertices() {
+        return shape->getVertices();
+    }
 
-        glUniform4f(3, color.r, color.g, color.b, color.a);
-        glCheck();
+    Slice<DVec2> points() {
+        return {vertexPool.points.data() + geometry.offset, degree};
+    }
 
-        glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
-        glCheck();
+    Slice<DEdge> edges() {
+        return {vertexPool.edges.data() + geometry.offset, degree};
+    }
 
-        // draw
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indexData.size()), GL_UNSIGNED_INT, indexData.data());
-        glCheck();
+    Slice<DVec2> normals() {
+        return {vertexPool.normals.data() + geometry.offset, degree};
     }
 
     virtual void move(double dt) {
@@ -158,109 +142,32 @@ public:
         sinθ = std::sin(rotation);
     }
     
-    void setPoints(std::vector<DVec2> &points, DVec2 &pos) {
-        for (size_t i = 0; i < vertices.size(); i++) {
-            points[i] = pos + vertices[i].getRotatedFast(cosθ, sinθ);
-        }
+    void setPoints(Slice<DVec2> points, DVec2 &pos) {
+        shape->kernels->setPoints(shape->vertices.data(), points.first, degree, pos, cosθ, sinθ);
     }
 
-    void setPoints(std::vector<DVec2>& points) {
-        for (size_t i = 0; i < vertices.size(); i++) {
-            points[i] = mid + vertices[i].getRotatedFast(cosθ, sinθ);
-        }
+    void setPoints(Slice<DVec2> points) {
+        shape->kernels->setPoints(shape->vertices.data(), points.first, degree, mid, cosθ, sinθ);
     }
 
-    void setEdges(std::vector<DEdge> &edges) {
-        for (size_t i = 0; i < points.size(); i++) {
-            size_t ip = (i+1) % points.size();
-            edges[i] = {points[i], points[ip]};
-        }
-    }
-
-    void setNormals(std::vector<DVec2> &normals)  {
-        for (size_t i = 0; i < edges.size(); i++) {
-            DVec2 vec = (edges[i].end - edges[i].start).getNormalized();
-            normals[i] = {vec.y, -vec.x};
-        }
-    }
-
-    void setAreaAndMid(double &area, DVec2 &mid) {
-        DVec2 P0 = points[0];
-
-        double totalArea = 0;
-        DVec2 midpoint(0, 0);
-        for (size_t i = 1; i < points.size()-1; i++) {
-            DVec2 Pi = points[i];
-            DVec2 Pii = points[i+1];
-
-            double subArea = std::abs((Pi - P0).cross(Pii - P0));
-            totalArea += subArea;
-            midpoint += ((P0 + Pi + Pii)/3)*subArea;
-        }
-
-        area = totalArea/2;
-        mid = midpoint/totalArea;
+    void setEdges(Slice<DEdge> edges) {
+        shape->kernels->setEdges(points().first, edges.first, degree);
     }
 
-    void setMoofin(double &moofin) {
-		double pseudoMoofin = 0;
-		double totalArea = 0;
-		for (size_t i = 0; i < points.size()-1; i++) {
-			DVec2 vi = points[i] - mid;
-            DVec2 vii = points[i+1] - mid;
-
-			double area = std::abs(vii.cross(vi));
-			double submoof = vi.getSquaredLength() + vi.dot(vii) + vii.getSquaredLength();
-
-			totalArea += area;
-			pseudoMoofin += area*submoof;
-        }
-
-		moofin = mass*(pseudoMoofin/totalArea)/6;
-    }
-
-    void setRadius(double& radius) {
-        // not realy a radius, the average of the length of the vertices
-        double sum = 0;
-        for (size_t i = 0; i < degree; i++) {
-            sum += vertices[i].getLength();
-        }
-        radius = sum/degree;
+    void setNormals(Slice<DVec2> normals)  {
+        shape->kernels->setNormals(shape->normals.data(), normals.first, degree, cosθ, sinθ);
     }
 
     void setHitbox(Hitbox &hitbox) {
-		double top = points[0].y;
-		double bottom = points[0].y;
-		double left = points[0].x;
-		double right = points[0].x;
-		for (size_t i = 1; i < points.size(); i++) {
-			top = std::max(top, points[i].y);
-			bottom = std::min(bottom, points[i].y);
-			left = std::min(left, points[i].x);
-			right = std::max(right, points[i].x);
-        }
-        hitbox.width = right-left;
-        hitbox.height = top-bottom;
-        hitbox.pos = {left, bottom};
+        shape->kernels->setHitbox(points().first, degree, hitbox);
     }
 
     double getMaxVal(DVec2 normal) {
-        double maxVal = -Infinity;
-        for (DVec2& point: points) {
-            double val = point.dot(normal);
-            maxVal = std::max(val, maxVal);
-        }
-        
-        return maxVal;
+        return shape->kernels->getMaxVal(points().first, degree, normal);
     }
 
     double getMinVal(DVec2 normal) {
-        double minVal = Infinity;
-        for (DVec2& point : points) {
-            double val = point.dot(normal);
-            minVal = std::min(val, minVal);
-        }
-        return minVal;
+        return shape->kernels->getMinVal(points().first, degree, normal);
     }
 
     double getLength(DVec2 normal) {
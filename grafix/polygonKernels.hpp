@@ -0,0 +1,125 @@
+#pragma once
+#include "vector2.hpp"
+#include "vertexPool.hpp"
+#include "hitbox.hpp"
+#include "utils.hpp"
+
+#include <array>
+#include <algorithm>
+
+// polygon routines with the vertex count known at compile time, so the loops are unrolled
+// and the projections work on std::arrays the compiler can vectorize.
+// N = 0 is the fallback for any other number of vertices.
+template<size_t N>
+struct PolygonKernels {
+    static constexpr size_t count(size_t degree) {
+        return N != 0 ? N : degree;
+    }
+
+    static void setPoints(const DVec2* vertices, DVec2* points, size_t degree, DVec2 pos, double cosθ, double sinθ) {
+        for (size_t i = 0; i < count(degree); i++) {
+            points[i] = pos + vertices[i].getRotatedFast(cosθ, sinθ);
+        }
+    }
+
+    static void setEdges(const DVec2* points, DEdge* edges, size_t degree) {
+        size_t n = count(degree);
+        for (size_t i = 0; i < n-1; i++) {
+            edges[i] = {points[i], points[i+1]};
+        }
+        edges[n-1] = {points[n-1], points[0]};
+    }
+
+    static void setNormals(const DVec2* localNormals, DVec2* normals, size_t degree, double cosθ, double sinθ) {
+        for (size_t i = 0; i < count(degree); i++) {
+            normals[i] = localNormals[i].getRotatedFast(cosθ, sinθ);
+        }
+    }
+
+    static void setHitbox(const DVec2* points, size_t degree, Hitbox &hitbox) {
+        double top = points[0].y;
+        double bottom = points[0].y;
+        double left = points[0].x;
+        double right = points[0].x;
+        for (size_t i = 1; i < count(degree); i++) {
+            top = std::max(top, points[i].y);
+            bottom = std::min(bottom, points[i].y);
+            left = std::min(left, points[i].x);
+            right = std::max(right, points[i].x);
+        }
+        hitbox.width = right-left;
+        hitbox.height = top-bottom;
+        hitbox.pos = {left, bottom};
+    }
+
+    static double getMaxVal(const DVec2* points, size_t degree, DVec2 normal) {
+        if (N == 0) {
+            double maxVal = -Infinity;
+            for (size_t i = 0; i < degree; i++) {
+                maxVal = std::max(points[i].dot(normal), maxVal);
+            }
+            return maxVal;
+        }
+        std::array<double, N != 0 ? N : 1> vals = project(points, normal);
+        double maxVal = vals[0];
+        for (size_t i = 1; i < N; i++) {
+            maxVal = std::max(vals[i], maxVal);
+        }
+        return maxVal;
+    }
+
+    static double getMinVal(const DVec2* points, size_t degree, DVec2 normal) {
+        if (N == 0) {
+            double minVal = Infinity;
+            for (size_t i = 0; i < degree; i++) {
+                minVal = std::min(points[i].dot(normal), minVal);
+            }
+            return minVal;
+        }
+        std::array<double, N != 0 ? N : 1> vals = project(points, normal);
+        double minVal = vals[0];
+        for (size_t i = 1; i < N; i++) {
+            minVal = std::min(vals[i], minVal);
+        }
+        return minVal;
+    }
+
+private:
+    static std::array<double, N != 0 ? N : 1> project(const DVec2* points, DVec2 normal) {
+        std::array<double, N != 0 ? N : 1> vals;
+        for (size_t i = 0; i < vals.size(); i++) {
+            vals[i] = points[i].x*normal.x + points[i].y*normal.y;
+        }
+        return vals;
+    }
+};
+
+// the kernels for one vertex count, picked once per shape
+struct KernelTable {
+    void (*setPoints)(const DVec2*, DVec2*, size_t, DVec2, double, double);
+    void (*setEdges)(const DVec2*, DEdge*, size_t);
+    void (*setNormals)(const DVec2*, DVec2*, size_t, double, double);
+    void (*setHitbox)(const DVec2*, size_t, Hitbox&);
+    double (*getMaxVal)(const DVec2*, size_t, DVec2);
+    double (*getMinVal)(const DVec2*, size_t, DVec2);
+};
+
+template<size_t N>
+const KernelTable kernelTable = {
+    PolygonKernels<N>::setPoints,
+    PolygonKernels<N>::setEdges,
+    PolygonKernels<N>::setNormals,
+    PolygonKernels<N>::setHitbox,
+    PolygonKernels<N>::getMaxVal,
+    PolygonKernels<N>::getMinVal,
+};
+
+// triangles, boxes and hexagons get their own kernels, everything else uses the dynamic ones
+inline const KernelTable* getKernelTable(size_t degree) {
+    switch (degree) {
+        case 3: return &kernelTable<3>;
+        case 4: return &kernelTable<4>;
+        case 6: return &kernelTable<6>;
+        default: return &kernelTable<0>;
+    }
+}
@@ -0,0 +1,139 @@
+#include "entities.hpp"
+#include "physics.hpp"
+#include "world.hpp"
+#include "renderState.hpp"
+#include "glUtils.hpp"
+#include "instancedRenderer.hpp"
+#include "cameraBuffer.hpp"
+#include "offscreenTarget.hpp"
+#include "frameReader.hpp"
+#include "softwareRasterizer.hpp"
+#include "utils.hpp"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+// renders the main scene without a window and writes every frame as a ppm image.
+// the world is stepped by the same amount per frame, so the output doesn't depend on how fast the machine is.
+// usage: grafixRecord [frames] [output directory, or - for stdout] [width] [height] [gpu or cpu]
+// with - the frames can be piped into an encoder: grafixRecord 600 - | ffmpeg -f image2pipe -c:v ppm -i - out.mp4
+// cpu draws with the software rasterizer and doesn't need an opengl context at all. it is far slower than the gpu,
+// 100k polygons at 1080p take 80 ms or more per frame on one core, fine for recording but not interactive
+int main(int argc, char** argv) {
+    int frameCount = argc > 1 ? std::atoi(argv[1]) : 60;
+    std::string directory = argc > 2 ? argv[2] : ".";
+    int width = argc > 3 ? std::atoi(argv[3]) : 1280;
+    int height = argc > 4 ? std::atoi(argv[4]) : 720;
+    bool cpu = argc > 5 && std::string(argv[5]) == "cpu";
+
+#ifdef _WIN32
+    // ppm is binary, stdout in text mode would turn every 0x0A byte into CRLF
+    if (directory == "-") {
+        _setmode(_fileno(stdout), _O_BINARY);
+    }
+#endif
+
+    int frame = 0;
+    FrameReader::Sink writeFrame = [&directory, &frame](const unsigned char* pixels, int width, int height) {
+        if (directory == "-") {
+            writePpm(stdout, pixels, width, height);
+            return;
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame%05d.ppm", frame);
+        std::FILE* file = std::fopen((directory + name).c_str(), "wb");
+        if (file == nullptr) {
+            print("can't write", directory + name);
+            return;
+        }
+        writePpm(file, pixels, width, height);
+        std::fclose(file);
+        frame++;
+    };
+
+    // only one of the backends is created
+    std::unique_ptr<SoftwareRasterizer> rasterizer;
+    std::vector<unsigned char> rgb;
+    std::unique_ptr<InstancedRenderer> renderer;
+    std::unique_ptr<OffscreenTarget> target;
+    std::unique_ptr<FrameReader> reader;
+    if (cpu) {
+        rasterizer.reset(new SoftwareRasterizer(width, height));
+    } else {
+        if (glInitOffscreen() == NULL) {
+            return 1;
+        }
+        renderer.reset(new InstancedRenderer());
+        target.reset(new OffscreenTarget(width, height));
+        reader.reset(new FrameReader(width, height, writeFrame));
+    }
+
+    World world;
+    getPlayerAndEntities(world.bodies, contentScale);
+    JobSystem jobs;
+    world.jobs = &jobs;
+
+    double fps = 60;
+    double pdt = 5e-3;
+    int stepsPerFrame = std::max(1, static_cast<int>(std::round(1/(fps*pdt))));
+
+    RenderState state;
+    std::vector<uint32_t> candidates;
+    GLfloat cameraMatrix[9];
+    Hitbox view = getCamera(width, height, cameraMatrix);
+    if (!cpu) {
+        cameraBuffer.update(cameraMatrix);
+    }
+
+    double time = getTime();
+    for (int i = 0; i < frameCount; i++) {
+        for (int step = 0; step < stepsPerFrame; step++) {
+            physicsUpdate(world, pdt);
+        }
+        captureRenderState(world, state, view, candidates);
+
+        if (cpu) {
+            rasterizer->draw(state, cameraMatrix, {1, 1, 1, 1}, &jobs);
+            rasterizer->getRgb(rgb);
+            writeFrame(rgb.data(), width, height);
+            continue;
+        }
+
+        target->bind();
+        glClearColor(1, 1, 1, 1);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glCheck();
+        renderer->draw(state);
+
+        // only starts the copy, the frame before this one is written out now
+        reader->read();
+    }
+    if (!cpu) {
+        reader->finish();
+    }
+    std::fflush(stdout);
+    print(frameCount, "frames in", getTime() - time, "s");
+
+    if (!cpu) {
+        reader->releaseBuffers();
+        target->releaseBuffers();
+        renderer->releaseBuffers();
+        geometryBuffer.releaseBuffers();
+        cameraBuffer.releaseBuffers();
+        glfwTerminate();
+    }
+    return 0;
+}
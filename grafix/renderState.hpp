@@ -0,0 +1,98 @@
+#pragma once
+#include "polygon.hpp"
+#include "world.hpp"
+#include "tripleBuffer.hpp"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// everything the renderer needs to know about a body
+struct BodySnapshot {
+    std::shared_ptr<const Shape> shape;
+    DVec2 mid;
+    double cosθ;
+    double sinθ;
+    GLcolor color;
+};
+
+// what the renderer needs to know about a world. static bodies never move,
+// so they are only copied again when bodies are added or removed
+struct RenderState {
+    std::vector<BodySnapshot> bodies;        // bodies that can move
+    std::vector<BodySnapshot> staticBodies;  // immovable and imrotatable bodies
+    uint64_t staticVersion = UINT64_MAX;     // body pool version staticBodies was copied at
+};
+
+// bodies that are made static after they were added aren't noticed until the next add or remove
+inline bool isStaticBody(const Polygon* body) {
+    return body->immovable && body->imrotatable;
+}
+
+inline void setSnapshot(BodySnapshot& snapshot, const Polygon* body) {
+    if (snapshot.shape != body->shape) {
+        snapshot.shape = body->shape;
+    }
+    snapshot.mid = body->mid;
+    snapshot.cosθ = body->cosθ;
+    snapshot.sinθ = body->sinθ;
+    snapshot.color = body->color;
+}
+
+// copy the static bodies again if bodies were added or removed since the last capture
+inline void captureStaticBodies(World& world, RenderState& state) {
+    if (state.staticVersion == world.bodies.getVersion()) {
+        return;
+    }
+    state.staticBodies.clear();
+    state.staticVersion = world.bodies.getVersion();
+    for (size_t i = 0; i < world.bodies.size(); i++) {
+        Polygon* body = world.bodies[i];
+        if (isStaticBody(body)) {
+            state.staticBodies.emplace_back();
+            setSnapshot(state.staticBodies.back(), body);
+        }
+    }
+}
+
+inline void addMovingSnapshot(RenderState& state, size_t& count, const Polygon* body) {
+    if (count == state.bodies.size()) {
+        state.bodies.emplace_back();
+    }
+    setSnapshot(state.bodies[count++], body);
+}
+
+// copy the transforms of every body, the vectors keep their memory between steps
+inline void captureRenderState(World& world, RenderState& state) {
+    captureStaticBodies(world, state);
+    size_t count = 0;
+    for (size_t i = 0; i < world.bodies.size(); i++) {
+        Polygon* body = world.bodies[i];
+        if (!isStaticBody(body)) {
+            addMovingSnapshot(state, count, body);
+        }
+    }
+    state.bodies.resize(count);
+}
+
+// like above, but only the moving bodies whose hitboxes overlap view, found with the world's spatial grid.
+// the grid is built at the start of a step and bodies have moved since, the margin covers that
+inline void captureRenderState(World& world, RenderState& state, const Hitbox& view, std::vector<uint32_t>& candidates) {
+    const double margin = 0.1;
+    captureStaticBodies(world, state);
+    Hitbox area(
+        view.pos - DVec2(view.width, view.height)*margin,
+        (1 + 2*margin)*view.width, (1 + 2*margin)*view.height
+    );
+    candidates.clear();
+    world.grid.query(area, candidates);
+
+    size_t count = 0;
+    for (uint32_t i : candidates) {
+        Polygon* body = world.bodies[i];
+        if (!isStaticBody(body) && body->hitbox.collides(view)) {
+            addMovingSnapshot(state, count, body);
+        }
+    }
+    state.bodies.resize(count);
+}
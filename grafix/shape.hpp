@@ -0,0 +1,161 @@
+#pragma once
+#include "vector2.hpp"
+#include "vertexPool.hpp"
+#include "smallVector.hpp"
+#include "polygonKernels.hpp"
+#include "utils.hpp"
+#include "geometryBuffer.hpp"
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <cmath>
+#include <glad/glad.h>
+
+// almost every polygon has at most 8 vertices, so their geometry is stored inline
+template<typename T>
+using VertexVector = SmallVector<T, 8>;
+
+// the immutable part of a polygon, shared by every body with the same local vertices
+class Shape {
+public:
+    size_t degree;
+    VertexVector<DVec2> vertices;
+    VertexVector<DVec2> normals;
+    SmallVector<GLuint, 18> indexData;
+
+    double area;
+    DVec2 centroid;
+    double moofinPerMass;
+    double radius;
+
+    // routines specialized on the degree of this shape
+    const KernelTable* kernels;
+
+    explicit Shape(const std::vector<DVec2>& vertices): degree(vertices.size()), vertices(vertices.begin(), vertices.end()) {
+        setAreaAndCentroid(area, centroid);
+        setNormals(normals);
+        setMoofinPerMass(moofinPerMass);
+        setRadius(radius);
+        kernels = getKernelTable(degree);
+
+        indexData.resize((degree-2)*3);
+        for (size_t i = 0; i < degree-2; i++) {
+            indexData[i*3] = static_cast<GLuint>(0);
+            indexData[i*3+1] = static_cast<GLuint>(i+1);
+            indexData[i*3+2] = static_cast<GLuint>(i+2);
+        }
+    }
+
+    Shape(const Shape&) = delete;
+    Shape& operator=(const Shape&) = delete;
+
+    // the next shape of the same size reuses the geometry
+    ~Shape() {
+        geometryBuffer.release(geometry);
+    }
+
+    Slice<const DVec2> getVertices() const {
+        return {vertices.data(), degree};
+    }
+
+    // the geometry is put into the geometry buffer the first time the shape is drawn
+    const GeometryRange& getGeometry() const {
+        if (!geometryBuffer.isCurrent(geometry)) {
+            geometry = geometryBuffer.add(vertices.data(), degree, indexData.data(), indexData.size());
+        }
+        return geometry;
+    }
+
+private:
+    mutable GeometryRange geometry;  // only touched by the thread that draws
+
+    void setAreaAndCentroid(double &area, DVec2 &centroid) {
+        DVec2 P0 = vertices[0];
+
+        double totalArea = 0;
+        DVec2 midpoint(0, 0);
+        for (size_t i = 1; i < degree-1; i++) {
+            DVec2 Pi = vertices[i];
+            DVec2 Pii = vertices[i+1];
+
+            double subArea = std::abs((Pi - P0).cross(Pii - P0));
+            totalArea += subArea;
+            midpoint += ((P0 + Pi + Pii)/3)*subArea;
+        }
+
+        area = totalArea/2;
+        centroid = midpoint/totalArea;
+    }
+
+    void setNormals(VertexVector<DVec2> &normals) {
+        normals.resize(degree);
+        for (size_t i = 0; i < degree; i++) {
+            size_t ip = (i+1) % degree;
+            DVec2 vec = (vertices[ip] - vertices[i]).getNormalized();
+            normals[i] = {vec.y, -vec.x};
+        }
+    }
+
+    void setMoofinPerMass(double &moofinPerMass) {
+        double pseudoMoofin = 0;
+        double totalArea = 0;
+        for (size_t i = 0; i < degree-1; i++) {
+            DVec2 vi = vertices[i] - centroid;
+            DVec2 vii = vertices[i+1] - centroid;
+
+            double area = std::abs(vii.cross(vi));
+            double submoof = vi.getSquaredLength() + vi.dot(vii) + vii.getSquaredLength();
+
+            totalArea += area;
+            pseudoMoofin += area*submoof;
+        }
+
+        moofinPerMass = (pseudoMoofin/totalArea)/6;
+    }
+
+    void setRadius(double& radius) {
+        // not realy a radius, the average of the length of the vertices
+        double sum = 0;
+        for (size_t i = 0; i < degree; i++) {
+            sum += vertices[i].getLength();
+        }
+        radius = sum/degree;
+    }
+};
+
+// hands out shared shapes, polygons with identical local vertices get the same shape
+class ShapeCache {
+public:
+    std::shared_ptr<const Shape> get(const std::vector<DVec2>& vertices) {
+        std::weak_ptr<const Shape>& entry = shapes[vertices];
+        std::shared_ptr<const Shape> shape = entry.lock();
+        if (!shape) {
+            shape = std::make_shared<const Shape>(vertices);
+            entry = shape;
+        }
+        return shape;
+    }
+
+private:
+    struct VerticesLess {
+        bool operator()(const std::vector<DVec2>& a, const std::vector<DVec2>& b) const {
+            if (a.size() != b.size()) {
+                return a.size() < b.size();
+            }
+            for (size_t i = 0; i < a.size(); i++) {
+                if (a[i].x != b[i].x) {
+                    return a[i].x < b[i].x;
+                }
+                if (a[i].y != b[i].y) {
+                    return a[i].y < b[i].y;
+                }
+            }
+            return false;
+        }
+    };
+
+    std::map<std::vector<DVec2>, std::weak_ptr<const Shape>, VerticesLess> shapes;
+};
+
+ShapeCache shapeCache;
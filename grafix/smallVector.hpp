@@ -0,0 +1,164 @@
+#pragma once
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <initializer_list>
+#include <type_traits>
+
+// a vector that keeps up to N elements inline and only allocates when it grows past that
+template<typename T, size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVector only holds trivially copyable types");
+
+public:
+    static const size_t inlineCapacity = N;
+
+    SmallVector() = default;
+
+    explicit SmallVector(size_t count) {
+        resize(count);
+    }
+
+    SmallVector(std::initializer_list<T> list) {
+        append(list.begin(), list.end());
+    }
+
+    template<typename Iterator>
+    SmallVector(Iterator first, Iterator last) {
+        append(first, last);
+    }
+
+    SmallVector(const SmallVector& other) {
+        append(other.begin(), other.end());
+    }
+
+    SmallVector(SmallVector&& other) noexcept {
+        steal(other);
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            count = 0;
+            append(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            freeHeap();
+            steal(other);
+        }
+        return *this;
+    }
+
+    ~SmallVector() {
+        freeHeap();
+    }
+
+    T* data() { return first; }
+    const T* data() const { return first; }
+    T* begin() { return first; }
+    T* end() { return first + count; }
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+    size_t size() const { return count; }
+    size_t capacity() const { return space; }
+    bool empty() const { return count == 0; }
+    bool isInline() const { return first == inlineData(); }
+
+    T& operator[](size_t i) { return first[i]; }
+    const T& operator[](size_t i) const { return first[i]; }
+    T& back() { return first[count-1]; }
+
+    void push_back(const T& value) {
+        if (count == space) {
+            // value may live inside this vector, so copy it before growing
+            T copy = value;
+            grow(space*2);
+            first[count++] = copy;
+        } else {
+            first[count++] = value;
+        }
+    }
+
+    void pop_back() {
+        count--;
+    }
+
+    template<typename Iterator>
+    void append(Iterator from, Iterator to) {
+        for (; from != to; ++from) {
+            push_back(*from);
+        }
+    }
+
+    void resize(size_t newCount) {
+        reserve(newCount);
+        for (size_t i = count; i < newCount; i++) {
+            first[i] = T();
+        }
+        count = newCount;
+    }
+
+    void reserve(size_t newCapacity) {
+        if (newCapacity > space) {
+            grow(newCapacity);
+        }
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+private:
+    alignas(T) unsigned char inlineBuffer[N*sizeof(T)];
+    T* first = inlineData();
+    size_t count = 0;
+    size_t space = N;
+
+    T* inlineData() { return reinterpret_cast<T*>(inlineBuffer); }
+    const T* inlineData() const { return reinterpret_cast<const T*>(inlineBuffer); }
+
+    void grow(size_t newCapacity) {
+        if (newCapacity < 1) {
+            newCapacity = 1;
+        }
+        T* heap = static_cast<T*>(std::malloc(newCapacity*sizeof(T)));
+        if (heap == nullptr) {
+            throw std::bad_alloc();
+        }
+        if (count != 0) {
+            std::memcpy(heap, first, count*sizeof(T));
+        }
+        freeHeap();
+        first = heap;
+        space = newCapacity;
+    }
+
+    void freeHeap() {
+        if (!isInline()) {
+            std::free(first);
+        }
+        first = inlineData();
+        space = N;
+    }
+
+    void steal(SmallVector& other) {
+        if (other.isInline()) {
+            first = inlineData();
+            space = N;
+            count = other.count;
+            if (count != 0) {
+                std::memcpy(first, other.first, count*sizeof(T));
+            }
+        } else {
+            first = other.first;
+            space = other.space;
+            count = other.count;
+            other.first = other.inlineData();
+            other.space = N;
+        }
+        other.count = 0;
+    }
+};
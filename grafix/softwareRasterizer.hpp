@@ -0,0 +1,312 @@
+#pragma once
+#include "renderState.hpp"
+#include "shape.hpp"
+#include "jobSystem.hpp"
+#include "utils.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <limits>
+
+// draws a render state into a framebuffer in memory, for machines without a gpu. vertices are transformed
+// like the camera uniform of the shaders and every body is filled as a convex polygon.
+// the polygons are set up and binned into tiles in parallel chunks, then the tiles are rasterized in parallel,
+// each with the polygons of every chunk whose bounding boxes touch it, in drawing order.
+// a polygon is drawn by evaluating its edge functions for blocks of pixels:
+// blocks outside an edge are skipped, blocks inside of all edges are filled, and only the blocks on an edge
+// are tested pixel by pixel, all pixels of a block at once so the compiler can put them into SIMD registers.
+// it is meant for recording, not for playing: 100k small polygons at 1920x1080 take 80 ms or more per frame
+// on one core, about 90% of it rasterizing the tiles
+class SoftwareRasterizer {
+public:
+    static const int tileSize = 64;
+    static const int blockSize = 8;
+    static_assert(tileSize % blockSize == 0, "blocks must not cross tiles");
+
+    // polygons transformed and edge functions set up per task
+    static const size_t polygonsPerChunk = 1024;
+
+    const int width;
+    const int height;
+
+    // the framebuffer is padded to whole tiles, so blocks never have to be clipped to it
+    SoftwareRasterizer(int width, int height):
+        width(width), height(height),
+        tilesX((width + tileSize - 1) / tileSize),
+        tilesY((height + tileSize - 1) / tileSize),
+        stride(tilesX*tileSize),
+        pixels(static_cast<size_t>(stride)*tilesY*tileSize) {}
+
+    SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+    SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+    // static bodies first like the gpu renderer, runs on jobs if it isn't null
+    void draw(const RenderState& state, const GLfloat cameraMatrix[9], GLcolor clearColor, JobSystem* jobs) {
+        size_t staticCount = state.staticBodies.size();
+        size_t count = staticCount + state.bodies.size();
+        polygons.resize(count);
+        size_t edgeCount = 0;
+        for (size_t i = 0; i < count; i++) {
+            const BodySnapshot& snapshot = i < staticCount ? state.staticBodies[i] : state.bodies[i - staticCount];
+            polygons[i].firstEdge = static_cast<uint32_t>(edgeCount);
+            edgeCount += snapshot.shape->degree;
+        }
+        edges.resize(edgeCount);
+        clear = packColor(clearColor);
+
+        // every chunk bins its own polygons, the tiles read the chunks' bins in chunk order
+        chunkCount = (count + polygonsPerChunk - 1) / polygonsPerChunk;
+        bins.resize(static_cast<size_t>(tilesX)*tilesY*chunkCount);
+
+        graph.clear();
+        TaskGraph::TaskRange setup = graph.addParallelFor(count, polygonsPerChunk, [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; i++) {
+                const BodySnapshot& snapshot = i < staticCount ? state.staticBodies[i] : state.bodies[i - staticCount];
+                setupPolygon(polygons[i], snapshot, cameraMatrix);
+            }
+            binPolygons(begin / polygonsPerChunk, begin, end);
+        });
+        // joins the chunks, so the tiles don't each need an edge from every chunk
+        TaskGraph::TaskId binned = graph.add([](size_t) {});
+        graph.precede(setup, binned);
+        TaskGraph::TaskRange raster = graph.addParallelFor(static_cast<size_t>(tilesX)*tilesY, 1, [this](size_t tile, size_t, size_t) {
+            rasterizeTile(tile);
+        });
+        graph.precede(binned, raster);
+
+        if (jobs) {
+            jobs->run(graph);
+        } else {
+            graph.runInline();
+        }
+    }
+
+    // rgba pixels with a row length of getStride(), rows from the bottom up like gl
+    const std::vector<uint32_t>& getPixels() const {
+        return pixels;
+    }
+
+    int getStride() const {
+        return stride;
+    }
+
+    // rgb pixels without padding, rows from the bottom up. what writePpm and FrameReader sinks take
+    void getRgb(std::vector<unsigned char>& rgb) const {
+        rgb.resize(static_cast<size_t>(width)*height*3);
+        unsigned char* out = rgb.data();
+        for (int y = 0; y < height; y++) {
+            const uint32_t* row = &pixels[static_cast<size_t>(y)*stride];
+            for (int x = 0; x < width; x++) {
+                *out++ = static_cast<unsigned char>(row[x]);
+                *out++ = static_cast<unsigned char>(row[x] >> 8);
+                *out++ = static_cast<unsigned char>(row[x] >> 16);
+            }
+        }
+    }
+
+private:
+    // a*x + b*y + c is at least 0 on the inside
+    struct Edge {
+        float a;
+        float b;
+        float c;
+    };
+
+    // pixels left .. right and bottom .. top may be covered, empty if left > right
+    struct ScreenPolygon {
+        uint32_t firstEdge;
+        uint32_t edgeCount;
+        int left;
+        int bottom;
+        int right;
+        int top;
+        uint32_t color;
+    };
+
+    static const int blockPixels = blockSize*blockSize;
+
+    struct BlockOffsets {
+        float x[blockPixels];
+        float y[blockPixels];
+
+        BlockOffsets() {
+            for (int k = 0; k < blockPixels; k++) {
+                x[k] = static_cast<float>(k % blockSize);
+                y[k] = static_cast<float>(k / blockSize);
+            }
+        }
+    };
+
+    int tilesX;
+    int tilesY;
+    int stride;
+    uint32_t clear = 0;
+    BlockOffsets offsets;  // of every pixel of a block from its corner pixel
+    std::vector<uint32_t> pixels;
+    std::vector<Edge> edges;
+    std::vector<ScreenPolygon> polygons;
+    size_t chunkCount = 0;
+    std::vector<std::vector<uint32_t>> bins;  // polygons per tile and chunk, at tile*chunkCount + chunk, in drawing order
+    TaskGraph graph;
+
+    static uint32_t packColor(GLcolor color) {
+        auto channel = [](GLfloat value) {
+            return static_cast<uint32_t>(std::min(std::max(value, 0.0f), 1.0f)*255 + 0.5f);
+        };
+        return channel(color.r) | channel(color.g) << 8 | channel(color.b) << 16 | channel(color.a) << 24;
+    }
+
+    // transform the vertices to pixels and turn the sides into edge functions, counterclockwise
+    void setupPolygon(ScreenPolygon& polygon, const BodySnapshot& snapshot, const GLfloat cameraMatrix[9]) {
+        const Shape& shape = *snapshot.shape;
+        Edge* polygonEdges = &edges[polygon.firstEdge];
+        polygon.color = packColor(snapshot.color);
+        polygon.edgeCount = static_cast<uint32_t>(shape.degree);
+        polygon.left = 0;
+        polygon.right = -1;
+        polygon.bottom = 0;
+        polygon.top = -1;
+
+        // the points go into the edges first, a, b = x, y
+        double minX = Infinity, minY = Infinity, maxX = -Infinity, maxY = -Infinity;
+        double area = 0;
+        for (size_t i = 0; i < shape.degree; i++) {
+            DVec2 point = snapshot.mid + shape.vertices[i].getRotatedFast(snapshot.cosθ, snapshot.sinθ);
+            double ndcX = cameraMatrix[0]*point.x + cameraMatrix[1]*point.y + cameraMatrix[2];
+            double ndcY = cameraMatrix[3]*point.x + cameraMatrix[4]*point.y + cameraMatrix[5];
+            double x = (ndcX + 1)*0.5*width;
+            double y = (ndcY + 1)*0.5*height;
+            polygonEdges[i] = {static_cast<float>(x), static_cast<float>(y), 0};
+            minX = std::min(minX, x);
+            minY = std::min(minY, y);
+            maxX = std::max(maxX, x);
+            maxY = std::max(maxY, y);
+        }
+        for (size_t i = 0; i < shape.degree; i++) {
+            const Edge& p = polygonEdges[i];
+            const Edge& q = polygonEdges[(i + 1) % shape.degree];
+            area += static_cast<double>(p.a)*q.b - static_cast<double>(q.a)*p.b;
+        }
+        if (area == 0) {
+            return;
+        }
+
+        float first[2] = {polygonEdges[0].a, polygonEdges[0].b};
+        float sign = area > 0 ? 1.0f : -1.0f;
+        for (size_t i = 0; i < shape.degree; i++) {
+            float px = polygonEdges[i].a;
+            float py = polygonEdges[i].b;
+            float qx = i + 1 < shape.degree ? polygonEdges[i + 1].a : first[0];
+            float qy = i + 1 < shape.degree ? polygonEdges[i + 1].b : first[1];
+            float a = -sign*(qy - py);
+            float b = sign*(qx - px);
+            polygonEdges[i] = {a, b, -(a*px + b*py)};
+        }
+
+        // pixel centers are at .5, clamped before the casts so far away polygons don't overflow
+        auto toPixel = [](double value, int size) {
+            return std::min(std::max(value - 0.5, -1.0), static_cast<double>(size));
+        };
+        polygon.left = std::max(0, static_cast<int>(std::ceil(toPixel(minX, width))));
+        polygon.bottom = std::max(0, static_cast<int>(std::ceil(toPixel(minY, height))));
+        polygon.right = std::min(width - 1, static_cast<int>(std::floor(toPixel(maxX, width))));
+        polygon.top = std::min(height - 1, static_cast<int>(std::floor(toPixel(maxY, height))));
+    }
+
+    // append every polygon of a chunk to the chunk's bins of the tiles its bounding box touches
+    void binPolygons(size_t chunk, size_t begin, size_t end) {
+        size_t tileCount = static_cast<size_t>(tilesX)*tilesY;
+        for (size_t tile = 0; tile < tileCount; tile++) {
+            bins[tile*chunkCount + chunk].clear();
+        }
+        for (uint32_t i = static_cast<uint32_t>(begin); i < end; i++) {
+            const ScreenPolygon& polygon = polygons[i];
+            if (polygon.left > polygon.right || polygon.bottom > polygon.top) {
+                continue;
+            }
+            for (int ty = polygon.bottom / tileSize; ty <= polygon.top / tileSize; ty++) {
+                for (int tx = polygon.left / tileSize; tx <= polygon.right / tileSize; tx++) {
+                    bins[(static_cast<size_t>(ty)*tilesX + tx)*chunkCount + chunk].push_back(i);
+                }
+            }
+        }
+    }
+
+    void rasterizeTile(size_t tile) {
+        int tileLeft = static_cast<int>(tile % tilesX)*tileSize;
+        int tileBottom = static_cast<int>(tile / tilesX)*tileSize;
+        for (int y = tileBottom; y < tileBottom + tileSize; y++) {
+            std::fill_n(&pixels[static_cast<size_t>(y)*stride + tileLeft], tileSize, clear);
+        }
+
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            for (uint32_t i : bins[tile*chunkCount + chunk]) {
+                rasterizePolygon(polygons[i], tileLeft, tileBottom);
+            }
+        }
+    }
+
+    // the blocks of the polygon's bounding box that are in the tile
+    void rasterizePolygon(const ScreenPolygon& polygon, int tileLeft, int tileBottom) {
+        int left = std::max(polygon.left, tileLeft) / blockSize * blockSize;
+        int bottom = std::max(polygon.bottom, tileBottom) / blockSize * blockSize;
+        int right = std::min(polygon.right, tileLeft + tileSize - 1);
+        int top = std::min(polygon.top, tileBottom + tileSize - 1);
+        for (int by = bottom; by <= top; by += blockSize) {
+            for (int bx = left; bx <= right; bx += blockSize) {
+                rasterizeBlock(polygon, bx, by);
+            }
+        }
+    }
+
+    void rasterizeBlock(const ScreenPolygon& polygon, int bx, int by) {
+        const Edge* polygonEdges = &edges[polygon.firstEdge];
+
+        // the corners of the block that are furthest inside and outside of every edge decide
+        bool full = true;
+        float x0 = bx + 0.5f;
+        float y0 = by + 0.5f;
+        float span = blockSize - 1;
+        for (uint32_t e = 0; e < polygon.edgeCount; e++) {
+            const Edge& edge = polygonEdges[e];
+            float base = edge.a*x0 + edge.b*y0 + edge.c;
+            float low = base + std::min(edge.a, 0.0f)*span + std::min(edge.b, 0.0f)*span;
+            float high = base + std::max(edge.a, 0.0f)*span + std::max(edge.b, 0.0f)*span;
+            if (high < 0) {
+                return;
+            }
+            full &= low >= 0;
+        }
+
+        // rows outside of the image are padding, drawing into them is harmless
+        if (full) {
+            for (int y = by; y < by + blockSize; y++) {
+                std::fill_n(&pixels[static_cast<size_t>(y)*stride + bx], blockSize, polygon.color);
+            }
+            return;
+        }
+
+        // every pixel of the block is one lane
+        uint32_t inside[blockPixels];
+        for (int k = 0; k < blockPixels; k++) {
+            inside[k] = ~0u;
+        }
+        for (uint32_t e = 0; e < polygon.edgeCount; e++) {
+            const Edge& edge = polygonEdges[e];
+            float base = edge.a*x0 + edge.b*y0 + edge.c;
+            for (int k = 0; k < blockPixels; k++) {
+                inside[k] &= base + edge.a*offsets.x[k] + edge.b*offsets.y[k] >= 0 ? ~0u : 0u;
+            }
+        }
+        for (int y = 0; y < blockSize; y++) {
+            uint32_t* row = &pixels[static_cast<size_t>(by + y)*stride + bx];
+            const uint32_t* rowInside = &inside[y*blockSize];
+            for (int k = 0; k < blockSize; k++) {
+                row[k] = (polygon.color & rowInside[k]) | (row[k] & ~rowInside[k]);
+            }
+        }
+    }
+};
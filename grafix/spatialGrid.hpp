@@ -0,0 +1,160 @@
+#pragma once
+#include "bodyPool.hpp"
+#include "hitbox.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+// buckets the bodies of a pool by the grid cells their hitboxes touch, so finding the bodies near an area
+// only looks at a few cells. cells are hashed into a fixed number of buckets, bodies of cells that share
+// a bucket only cost an extra hitbox test. bodies that would cover too many cells, like walls,
+// are kept in a list that every query returns
+class SpatialGrid {
+public:
+    // a body covering more cells than this goes into the large list
+    static const size_t maxCellsPerBody = 16;
+
+    // the cell size is twice the median body size, so most bodies touch at most 4 cells
+    void build(const BodyPool& bodies) {
+        size_t count = bodies.size();
+        large.clear();
+        bucketStart.clear();
+        entries.clear();
+        if (count == 0) {
+            return;
+        }
+
+        sizes.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            const Hitbox& hitbox = bodies[i]->hitbox;
+            sizes[i] = std::max(hitbox.width, hitbox.height);
+        }
+        std::nth_element(sizes.begin(), sizes.begin() + count/2, sizes.end());
+        cellSize = std::max(2*sizes[count/2], 1e-6);
+
+        size_t bucketCount = 1;
+        while (bucketCount < 2*count) {
+            bucketCount *= 2;
+        }
+        bucketMask = bucketCount - 1;
+
+        // count the entries of every bucket, then fill them in body order
+        bucketStart.assign(bucketCount + 1, 0);
+        for (uint32_t i = 0; i < count; i++) {
+            CellRange range = getCells(bodies[i]->hitbox);
+            if (range.size() > maxCellsPerBody) {
+                large.push_back(i);
+                continue;
+            }
+            forEachCell(range, [this](int64_t x, int64_t y) { bucketStart[getBucket(x, y) + 1]++; });
+        }
+        for (size_t b = 0; b < bucketCount; b++) {
+            bucketStart[b + 1] += bucketStart[b];
+        }
+        entries.resize(bucketStart.back());
+        next.assign(bucketStart.begin(), bucketStart.end() - 1);
+        size_t largeIndex = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (largeIndex < large.size() && large[largeIndex] == i) {
+                largeIndex++;
+                continue;
+            }
+            forEachCell(getCells(bodies[i]->hitbox), [this, i](int64_t x, int64_t y) {
+                entries[next[getBucket(x, y)]++] = i;
+            });
+        }
+    }
+
+    // whether a body is in the large list, these are better tested against everything directly
+    bool isLarge(uint32_t body) const {
+        return std::binary_search(large.begin(), large.end(), body);
+    }
+
+    // appends the bodies whose cells overlap area to out, sorted and without duplicates.
+    // these are candidates, their hitboxes still have to be tested
+    template<typename Vector>
+    void query(const Hitbox& area, Vector& out) const {
+        size_t first = out.size();
+        out.insert(out.end(), large.begin(), large.end());
+        if (!bucketStart.empty()) {
+            CellRange range = getCells(area);
+            if (range.size() > bucketMask + 1) {
+                // an area larger than the table sees every bucket anyway
+                out.insert(out.end(), entries.begin(), entries.end());
+            } else {
+                forEachCell(range, [this, &out](int64_t x, int64_t y) {
+                    size_t bucket = getBucket(x, y);
+                    out.insert(out.end(), entries.begin() + bucketStart[bucket], entries.begin() + bucketStart[bucket + 1]);
+                });
+            }
+        }
+        std::sort(out.begin() + first, out.end());
+        out.erase(std::unique(out.begin() + first, out.end()), out.end());
+    }
+
+private:
+    // cell coordinates are clamped to this, so runaway bodies and nan hitboxes still give valid cells
+    static const int64_t maxCell = int64_t(1) << 40;
+
+    struct CellRange {
+        int64_t left, bottom, right, top;
+
+        // saturates instead of wrapping, so huge ranges still take the large and whole table paths
+        size_t size() const {
+            if (right < left || top < bottom) {
+                return 0;
+            }
+            uint64_t width = static_cast<uint64_t>(right - left) + 1;
+            uint64_t height = static_cast<uint64_t>(top - bottom) + 1;
+            if (width > SIZE_MAX / height) {
+                return SIZE_MAX;
+            }
+            return static_cast<size_t>(width*height);
+        }
+    };
+
+    double cellSize = 1;
+    size_t bucketMask = 0;
+    std::vector<uint32_t> bucketStart;
+    std::vector<uint32_t> entries;
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> large;  // sorted
+    std::vector<double> sizes;
+
+    CellRange getCells(const Hitbox& hitbox) const {
+        return {
+            getCell(hitbox.pos.x),
+            getCell(hitbox.pos.y),
+            getCell(hitbox.pos.x + hitbox.width),
+            getCell(hitbox.pos.y + hitbox.height)
+        };
+    }
+
+    // the cast is only defined for values in range, nan ends up in the lowest cell
+    int64_t getCell(double coordinate) const {
+        double cell = std::floor(coordinate / cellSize);
+        if (!(cell > -maxCell)) {
+            return -maxCell;
+        }
+        if (cell > maxCell) {
+            return maxCell;
+        }
+        return static_cast<int64_t>(cell);
+    }
+
+    template<typename Function>
+    static void forEachCell(const CellRange& range, Function fn) {
+        for (int64_t y = range.bottom; y <= range.top; y++) {
+            for (int64_t x = range.left; x <= range.right; x++) {
+                fn(x, y);
+            }
+        }
+    }
+
+    size_t getBucket(int64_t x, int64_t y) const {
+        uint64_t hash = static_cast<uint64_t>(x)*0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(y)*0xC2B2AE3D27D4EB4Full;
+        return static_cast<size_t>(hash >> 32) & bucketMask;
+    }
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include "renderState.hpp"
+#include "shape.hpp"
+#include "utils.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+
+// the static bodies of a scene transformed into world space and merged into one mesh with a color per vertex,
+// so all of them are drawn with a single call. the mesh is rebaked when the set of static bodies changes
+class StaticMesh {
+public:
+    StaticMesh() = default;
+    StaticMesh(const StaticMesh&) = delete;
+    StaticMesh& operator=(const StaticMesh&) = delete;
+
+    bool isCurrent(const RenderState& state) const {
+        return bakedVersion == state.staticVersion;
+    }
+
+    void bake(const RenderState& state) {
+        vertexData.clear();
+        indexData.clear();
+        for (const BodySnapshot& snapshot : state.staticBodies) {
+            const Shape& shape = *snapshot.shape;
+            GLuint baseVertex = static_cast<GLuint>(vertexData.size());
+            for (size_t i = 0; i < shape.degree; i++) {
+                DVec2 point = snapshot.mid + shape.vertices[i].getRotatedFast(snapshot.cosθ, snapshot.sinθ);
+                vertexData.push_back({static_cast<GLfloat>(point.x), static_cast<GLfloat>(point.y), snapshot.color});
+            }
+            for (GLuint index : shape.indexData) {
+                indexData.push_back(baseVertex + index);
+            }
+        }
+
+        if (vao == 0) {
+            glGenVertexArrays(1, &vao);
+            glGenBuffers(1, &vbo);
+            glGenBuffers(1, &ebo);
+        }
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertexData.size()*sizeof(Vertex), vertexData.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size()*sizeof(GLuint), indexData.data(), GL_STATIC_DRAW);
+
+        // the vertices are already in world space, so the instance transform is a constant identity
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, x));
+        glDisableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, color));
+        glCheck();
+
+        indexCount = indexData.size();
+        bakedVersion = state.staticVersion;
+    }
+
+    // draw with the instanced renderer's program, which has to be bound already
+    void draw() const {
+        if (indexCount == 0) {
+            return;
+        }
+        glBindVertexArray(vao);
+        glVertexAttrib4f(1, 0, 0, 1, 0);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indexCount), GL_UNSIGNED_INT, (void *)0);
+        glCheck();
+    }
+
+    // must be called while the gl context still exists
+    void releaseBuffers() {
+        if (vao != 0) {
+            glDeleteVertexArrays(1, &vao);
+            glDeleteBuffers(1, &vbo);
+            glDeleteBuffers(1, &ebo);
+        }
+        vao = 0;
+        vbo = 0;
+        ebo = 0;
+        indexCount = 0;
+        bakedVersion = UINT64_MAX;
+    }
+
+private:
+    struct Vertex {
+        GLfloat x;
+        GLfloat y;
+        GLcolor color;
+    };
+
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    size_t indexCount = 0;
+    uint64_t bakedVersion = UINT64_MAX;
+
+    std::vector<Vertex> vertexData;
+    std::vector<GLuint> indexData;
+};
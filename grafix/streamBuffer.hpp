@@ -0,0 +1,100 @@
+#pragma once
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <glad/glad.h>
+
+// a buffer that stays mapped, the cpu writes straight into memory the gpu reads from.
+// it is split into regions that are used round robin, one per frame. a fence after the draws
+// that read a region keeps the cpu from writing into it again before the gpu is done with it.
+// needs gl 4.4 or ARB_buffer_storage
+class StreamBuffer {
+public:
+    static const size_t regionCount = 3;
+
+    static bool isSupported() {
+        return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+    }
+
+    StreamBuffer() = default;
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // move on to the next region and make room for size bytes in it, waits if the gpu still reads it
+    void* map(size_t size) {
+        if (size > regionSize) {
+            allocate(std::max(size, regionSize*2));
+        }
+        region = (region + 1) % regionCount;
+        wait(region);
+        return mapped + getOffset();
+    }
+
+    // call after the draws that read the current region
+    void fence() {
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glCheck();
+    }
+
+    GLuint getBuffer() const {
+        return buffer;
+    }
+
+    // byte offset of the current region in the buffer
+    size_t getOffset() const {
+        return region*regionSize;
+    }
+
+    // must be called while the gl context still exists
+    void releaseBuffers() {
+        for (size_t i = 0; i < regionCount; i++) {
+            wait(i);
+        }
+        if (buffer != 0) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = 0;
+        mapped = nullptr;
+        regionSize = 0;
+    }
+
+private:
+    // regions start at multiples of this, enough for any attribute or uniform block alignment
+    static const size_t regionAlignment = 256;
+
+    GLuint buffer = 0;
+    unsigned char* mapped = nullptr;
+    size_t regionSize = 0;
+    size_t region = 0;
+    GLsync fences[regionCount] = {};
+
+    void wait(size_t i) {
+        if (fences[i] == nullptr) {
+            return;
+        }
+        while (true) {
+            GLenum result = glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) {
+                break;
+            }
+        }
+        glDeleteSync(fences[i]);
+        fences[i] = nullptr;
+    }
+
+    // a new buffer with regions of at least size bytes, after the gpu is done with the old one
+    void allocate(size_t size) {
+        releaseBuffers();
+        regionSize = (size + regionAlignment - 1) / regionAlignment * regionAlignment;
+
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize*regionCount, nullptr, flags);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize*regionCount, flags));
+        glCheck();
+    }
+};
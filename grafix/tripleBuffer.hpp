@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// hands the latest value from one writer thread to one reader thread without locks.
+// the writer and the reader each own one of the three buffers and swap it with the spare one,
+// so neither of them ever waits for the other and the reader always gets the newest finished value
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // the buffer the writer fills, only touched by the writer thread
+    T& writeBuffer() {
+        return buffers[writeIndex];
+    }
+
+    // make the write buffer the newest value and continue with the spare one
+    void publish() {
+        writeIndex = spare.exchange(writeIndex | fresh, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // swap in the newest value if there is one, returns whether it changed
+    bool update() {
+        if ((spare.load(std::memory_order_relaxed) & fresh) == 0) {
+            return false;
+        }
+        readIndex = spare.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    // the buffer the reader uses, only touched by the reader thread
+    const T& readBuffer() const {
+        return buffers[readIndex];
+    }
+
+private:
+    static const uint8_t indexMask = 3;
+    static const uint8_t fresh = 4;  // set while the spare buffer holds a value the reader hasn't seen
+
+    T buffers[3];
+    uint8_t writeIndex = 0;
+    uint8_t readIndex = 1;
+    std::atomic<uint8_t> spare{2};
+};
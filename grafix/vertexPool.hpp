@@ -0,0 +1,117 @@
+#pragma once
+#include "vector2.hpp"
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+struct DEdge {
+    DVec2 start;
+    DVec2 end;
+};
+
+// a view of count elements starting at first, usable in range based for loops
+template<typename T>
+class Slice {
+public:
+    T* first;
+    size_t count;
+
+    T* begin() const { return first; }
+    T* end() const { return first + count; }
+    size_t size() const { return count; }
+    T& operator[](size_t i) const { return first[i]; }
+};
+
+// the world space geometry of all polygons lives in these contiguous arrays, each polygon owns a range of them.
+// allocating past the capacity moves every range, so a Slice into the pool is only valid until the next body
+// is created. polygons look their ranges up on every access, nothing may keep a slice across adding a body
+class VertexPool {
+public:
+    std::vector<DVec2> points;
+    std::vector<DEdge> edges;
+    std::vector<DVec2> normals;
+
+    // released ranges, indexed by their length
+    std::vector<std::vector<size_t>> freeRanges;
+
+    size_t allocate(size_t count) {
+        if (count < freeRanges.size() && !freeRanges[count].empty()) {
+            size_t offset = freeRanges[count].back();
+            freeRanges[count].pop_back();
+            return offset;
+        }
+        size_t offset = points.size();
+        points.resize(offset + count);
+        edges.resize(offset + count);
+        normals.resize(offset + count);
+        return offset;
+    }
+
+    void release(size_t offset, size_t count) {
+        if (count >= freeRanges.size()) {
+            freeRanges.resize(count + 1);
+        }
+        freeRanges[count].push_back(offset);
+    }
+
+    // vertices in use or released, where the next new range would start
+    size_t size() const {
+        return points.size();
+    }
+
+    // room for count vertices in total, allocations up to that don't move anything.
+    // grows at least to twice the capacity, so every world reserving a bit more on top stays linear
+    void reserve(size_t count) {
+        if (count <= points.capacity()) {
+            return;
+        }
+        count = std::max(count, points.capacity()*2);
+        points.reserve(count);
+        edges.reserve(count);
+        normals.reserve(count);
+    }
+
+    void clear() {
+        points.clear();
+        edges.clear();
+        normals.clear();
+        freeRanges.clear();
+    }
+};
+
+VertexPool vertexPool;
+
+// owns a range of the vertex pool, copies get their own range
+class VertexRange {
+public:
+    size_t offset = 0;
+    size_t count = 0;
+
+    VertexRange() = default;
+    explicit VertexRange(size_t count): offset(vertexPool.allocate(count)), count(count) {}
+
+    VertexRange(const VertexRange& other): VertexRange(other.count) {
+        for (size_t i = 0; i < count; i++) {
+            vertexPool.points[offset + i] = vertexPool.points[other.offset + i];
+            vertexPool.edges[offset + i] = vertexPool.edges[other.offset + i];
+            vertexPool.normals[offset + i] = vertexPool.normals[other.offset + i];
+        }
+    }
+
+    VertexRange(VertexRange&& other) noexcept: offset(other.offset), count(other.count) {
+        other.count = 0;
+    }
+
+    VertexRange& operator=(VertexRange other) noexcept {
+        std::swap(offset, other.offset);
+        std::swap(count, other.count);
+        return *this;
+    }
+
+    ~VertexRange() {
+        if (count != 0) {
+            vertexPool.release(offset, count);
+        }
+    }
+};
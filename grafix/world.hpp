@@ -0,0 +1,79 @@
+#pragma once
+#include "bodyPool.hpp"
+#include "frameArena.hpp"
+#include "jobSystem.hpp"
+#include "contactColoring.hpp"
+#include "spatialGrid.hpp"
+#include "vector2.hpp"
+
+#include <vector>
+#include <cstdint>
+
+struct BodyPair {
+    uint32_t i;
+    uint32_t j;
+};
+
+// what the narrowphase found for one pair
+struct ContactResult {
+    bool colliding;
+    uint32_t left;
+    uint32_t right;
+    DVec2 force;  // acts on left, right gets the opposite force
+    double leftTourqe;
+    double rightTourqe;
+};
+
+// a contact acting on a body
+struct BodyContact {
+    uint32_t contact;
+    bool left;
+};
+
+// the constants of the force model
+struct PhysicsParams {
+    double k = 10000;         // contact spring stiffness
+    double d = 80;            // contact damping
+    double mu = 0.5;          // friction coefficient
+    double Cd = 0.25;         // translation drag coefficient
+    double rotationCd = 0.15; // rotation drag coefficient
+};
+
+// everything one simulation needs between steps
+struct World {
+    BodyPool bodies;
+    PhysicsParams params;
+
+    // runs the steps on several threads when set, the world does not own it
+    JobSystem* jobs = nullptr;
+
+    // apply the contact forces color by color instead of summing them per body,
+    // this is how a contact solver would run in parallel
+    bool colorContacts = false;
+
+    // steps are always bitwise reproducible for any thread count. this also makes them independent of
+    // where bodies sit in the pool, which removing bodies changes: two worlds with the same bodies under
+    // the same handles step identically. without removals it gives the same results as the default
+    bool deterministic = false;
+
+    // scratch memory for a single physics step, one arena per thread
+    std::vector<FrameArena> threadArenas;
+
+    // per step buffers, kept so their memory is reused
+    TaskGraph graph;
+    SpatialGrid grid;  // built from the hitboxes at the start of every step
+    std::vector<std::vector<BodyPair>> chunkPairs;
+    std::vector<BodyPair> pairs;
+    std::vector<ContactResult> contacts;
+    std::vector<uint32_t> contactStart;
+    std::vector<uint32_t> contactNext;
+    std::vector<BodyContact> bodyContacts;
+    ContactColoring coloring;
+
+    // scenes this size are set up and grown without moving the vertex pool, while no other world adds bodies
+    static const size_t initialCapacity = 1024;
+
+    World() {
+        bodies.reserve(initialCapacity);
+    }
+};
@@ -0,0 +1,324 @@
+#pragma once
+#include "physics.hpp"
+#include "world.hpp"
+#include "frameArena.hpp"
+#include "vector2.hpp"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cmath>
+
+// Lanes worlds with the same bodies that only differ in their state and parameters, stepped together.
+// the state of every body is stored as one value per world next to each other, so integration, drag,
+// transforms and broadphase run once for all worlds and the compiler can put the lanes into SIMD registers.
+// SAT only runs for the worlds whose hitboxes overlap, that is where the worlds go their own way.
+// every world ends up bit-identical to stepping it on its own with physicsUpdate.
+// move() overrides aren't called, so this is for scenes without input
+template<size_t Lanes>
+class WorldLanes {
+public:
+    static_assert(Lanes >= 1 && Lanes <= 32, "the lanes of a pair are kept in a 32 bit mask");
+
+    // the worlds must have the same bodies with the same shapes in the same order
+    explicit WorldLanes(const std::vector<World*>& laneWorlds) {
+        if (laneWorlds.size() != Lanes) {
+            throw std::invalid_argument("WorldLanes needs one world per lane");
+        }
+        std::copy(laneWorlds.begin(), laneWorlds.end(), worlds);
+
+        size_t bodyCount = worlds[0]->bodies.size();
+        for (size_t l = 0; l < Lanes; l++) {
+            if (worlds[l]->bodies.size() != bodyCount) {
+                throw std::invalid_argument("the worlds of WorldLanes have different bodies");
+            }
+            Cd[l] = worlds[l]->params.Cd;
+            rotationCd[l] = worlds[l]->params.rotationCd;
+        }
+
+        bodies.resize(bodyCount);
+        size_t pointCount = 0;
+        for (size_t i = 0; i < bodyCount; i++) {
+            Polygon* first = worlds[0]->bodies[i];
+            BodyLanes& body = bodies[i];
+            body.shape = first->shape.get();
+            body.degree = first->degree;
+            body.mass = first->mass;
+            body.moofin = first->moofin;
+            body.radius = first->radius;
+            body.immovable = first->immovable;
+            body.imrotatable = first->imrotatable;
+            body.firstPoint = pointCount;
+            pointCount += body.degree;
+            for (size_t l = 0; l < Lanes; l++) {
+                if (worlds[l]->bodies[i]->shape.get() != body.shape) {
+                    throw std::invalid_argument("the worlds of WorldLanes have different bodies");
+                }
+            }
+        }
+
+        points.resize(pointCount);
+        for (size_t l = 0; l < Lanes; l++) {
+            gather(l);
+        }
+    }
+
+    World& world(size_t lane) {
+        return *worlds[lane];
+    }
+
+    // the same as physicsUpdate(world(l), pdt) for every lane
+    void update(double pdt) {
+        arena.reset();
+        addContactForces();
+        for (BodyLanes& body : bodies) {
+            applyAirResistance(body);
+            integrate(body, pdt);
+            if (!(body.immovable && body.imrotatable)) {
+                refresh(body);
+                for (size_t l = 0; l < Lanes; l++) {
+                    scatter(body, l);
+                }
+            }
+        }
+    }
+
+private:
+    struct alignas(Lanes*sizeof(double)) PointLanes {
+        double x[Lanes];
+        double y[Lanes];
+    };
+
+    struct alignas(Lanes*sizeof(double)) BodyLanes {
+        // the same in every lane
+        const Shape* shape;
+        size_t degree;
+        double mass;
+        double moofin;
+        double radius;
+        bool immovable;
+        bool imrotatable;
+        size_t firstPoint;
+
+        // one value per lane
+        double midX[Lanes], midY[Lanes];
+        double velX[Lanes], velY[Lanes];
+        double accX[Lanes], accY[Lanes];
+        double forceX[Lanes], forceY[Lanes];
+        double rotation[Lanes], rotVel[Lanes], rotAcc[Lanes], tourqe[Lanes];
+        double cosθ[Lanes], sinθ[Lanes];
+        double hitboxX[Lanes], hitboxY[Lanes], hitboxWidth[Lanes], hitboxHeight[Lanes];
+    };
+
+    World* worlds[Lanes];
+    alignas(Lanes*sizeof(double)) double Cd[Lanes];
+    alignas(Lanes*sizeof(double)) double rotationCd[Lanes];
+    std::vector<BodyLanes> bodies;
+    std::vector<PointLanes> points;
+    FrameArena arena;
+
+    // copy the state of a lane's bodies into the lanes
+    void gather(size_t l) {
+        for (size_t i = 0; i < bodies.size(); i++) {
+            BodyLanes& body = bodies[i];
+            Polygon* polygon = worlds[l]->bodies[i];
+            body.midX[l] = polygon->mid.x;
+            body.midY[l] = polygon->mid.y;
+            body.velX[l] = polygon->vel.x;
+            body.velY[l] = polygon->vel.y;
+            body.accX[l] = polygon->acc.x;
+            body.accY[l] = polygon->acc.y;
+            body.forceX[l] = polygon->force.x;
+            body.forceY[l] = polygon->force.y;
+            body.rotation[l] = polygon->rotation;
+            body.rotVel[l] = polygon->rotVel;
+            body.rotAcc[l] = polygon->rotAcc;
+            body.tourqe[l] = polygon->tourqe;
+            body.cosθ[l] = polygon->cosθ;
+            body.sinθ[l] = polygon->sinθ;
+            body.hitboxX[l] = polygon->hitbox.pos.x;
+            body.hitboxY[l] = polygon->hitbox.pos.y;
+            body.hitboxWidth[l] = polygon->hitbox.width;
+            body.hitboxHeight[l] = polygon->hitbox.height;
+            Slice<DVec2> polygonPoints = polygon->points();
+            for (size_t v = 0; v < body.degree; v++) {
+                points[body.firstPoint + v].x[l] = polygonPoints[v].x;
+                points[body.firstPoint + v].y[l] = polygonPoints[v].y;
+            }
+        }
+    }
+
+    // write a body's lane back into its polygon, the narrowphase and the telemetry read the polygons
+    void scatter(BodyLanes& body, size_t l) {
+        Polygon* polygon = worlds[l]->bodies[&body - bodies.data()];
+        polygon->mid = {body.midX[l], body.midY[l]};
+        polygon->vel = {body.velX[l], body.velY[l]};
+        polygon->acc = {body.accX[l], body.accY[l]};
+        polygon->force = {body.forceX[l], body.forceY[l]};
+        polygon->rotation = body.rotation[l];
+        polygon->rotVel = body.rotVel[l];
+        polygon->rotAcc = body.rotAcc[l];
+        polygon->tourqe = body.tourqe[l];
+        polygon->cosθ = body.cosθ[l];
+        polygon->sinθ = body.sinθ[l];
+        polygon->hitbox = Hitbox({body.hitboxX[l], body.hitboxY[l]}, body.hitboxWidth[l], body.hitboxHeight[l]);
+        Slice<DVec2> polygonPoints = polygon->points();
+        for (size_t v = 0; v < body.degree; v++) {
+            polygonPoints[v] = {points[body.firstPoint + v].x[l], points[body.firstPoint + v].y[l]};
+        }
+        polygon->setEdges(polygon->edges());
+        polygon->setNormals(polygon->normals());
+    }
+
+    // the lanes in which the hitboxes of a and b overlap, the same test as Hitbox::collides
+    static uint32_t getOverlapMask(const BodyLanes& a, const BodyLanes& b) {
+        uint32_t mask = 0;
+        for (size_t l = 0; l < Lanes; l++) {
+            bool overlap =
+                (a.hitboxX[l] + a.hitboxWidth[l] > b.hitboxX[l]) & (a.hitboxX[l] < b.hitboxX[l] + b.hitboxWidth[l])
+                & (a.hitboxY[l] + a.hitboxHeight[l] > b.hitboxY[l]) & (a.hitboxY[l] < b.hitboxY[l] + b.hitboxHeight[l]);
+            mask |= static_cast<uint32_t>(overlap) << l;
+        }
+        return mask;
+    }
+
+    // broadphase for all lanes at once, then SAT per lane in pair order, so every body sums its contacts like reduceForces
+    void addContactForces() {
+        for (uint32_t i = 0; i < bodies.size(); i++) {
+            for (uint32_t j = i+1; j < bodies.size(); j++) {
+                BodyLanes& a = bodies[i];
+                BodyLanes& b = bodies[j];
+                if (a.immovable && a.imrotatable && b.immovable && b.imrotatable) {
+                    continue;
+                }
+                uint32_t mask = getOverlapMask(a, b);
+                while (mask != 0) {
+                    size_t l = 0;
+                    while ((mask & (uint32_t(1) << l)) == 0) {
+                        l++;
+                    }
+                    mask &= mask - 1;
+                    addContactForce(l, i, j);
+                }
+            }
+        }
+    }
+
+    void addContactForce(size_t l, uint32_t i, uint32_t j) {
+        World& laneWorld = *worlds[l];
+        CollisionData collisionData = isColliding(*laneWorld.bodies[i], *laneWorld.bodies[j], arena);
+        if (!collisionData.colliding) {
+            return;
+        }
+        DVec2 force;
+        double leftTourqe, rightTourqe;
+        getContactForce(collisionData, laneWorld.params, force, leftTourqe, rightTourqe);
+        BodyLanes& left = collisionData.leftPoly == laneWorld.bodies[i] ? bodies[i] : bodies[j];
+        BodyLanes& right = &left == &bodies[i] ? bodies[j] : bodies[i];
+        left.forceX[l] += force.x;
+        left.forceY[l] += force.y;
+        left.tourqe[l] += leftTourqe;
+        right.forceX[l] += -force.x;
+        right.forceY[l] += -force.y;
+        right.tourqe[l] += rightTourqe;
+    }
+
+    // the same as the scalar applyAirResistance, with the projections done on the point lanes
+    void applyAirResistance(BodyLanes& body) {
+        alignas(Lanes*sizeof(double)) double normalX[Lanes], normalY[Lanes], maxVal[Lanes], minVal[Lanes];
+        for (size_t l = 0; l < Lanes; l++) {
+            double length = std::sqrt(body.velX[l]*body.velX[l] + body.velY[l]*body.velY[l]);
+            normalX[l] = -(body.velY[l] / length);
+            normalY[l] = body.velX[l] / length;
+        }
+        PointLanes* bodyPoints = points.data() + body.firstPoint;
+        for (size_t l = 0; l < Lanes; l++) {
+            maxVal[l] = bodyPoints[0].x[l]*normalX[l] + bodyPoints[0].y[l]*normalY[l];
+            minVal[l] = maxVal[l];
+        }
+        for (size_t v = 1; v < body.degree; v++) {
+            for (size_t l = 0; l < Lanes; l++) {
+                double val = bodyPoints[v].x[l]*normalX[l] + bodyPoints[v].y[l]*normalY[l];
+                maxVal[l] = std::max(val, maxVal[l]);
+                minVal[l] = std::min(val, minVal[l]);
+            }
+        }
+        for (size_t l = 0; l < Lanes; l++) {
+            // translation drag
+            if (body.velX[l]*body.velX[l] + body.velY[l]*body.velY[l] != 0) {
+                double lineArea = maxVal[l] - minVal[l];
+                double dragFactor = -Cd[l]*lineArea;
+                body.forceX[l] += body.velX[l]*dragFactor;
+                body.forceY[l] += body.velY[l]*dragFactor;
+            }
+
+            // rotation drag
+            body.tourqe[l] += -2.0/3*rotationCd[l]*body.rotVel[l]*body.radius*body.radius*body.radius;
+        }
+    }
+
+    // the same as Polygon::step
+    void integrate(BodyLanes& body, double dt) {
+        if (!body.immovable) {
+            for (size_t l = 0; l < Lanes; l++) {
+                body.accX[l] = body.forceX[l] / body.mass;
+                body.accY[l] = body.forceY[l] / body.mass;
+                body.velX[l] += body.accX[l] * dt;
+                body.velY[l] += body.accY[l] * dt;
+                body.midX[l] += body.velX[l] * dt;
+                body.midY[l] += body.velY[l] * dt;
+            }
+        }
+        std::fill(body.forceX, body.forceX + Lanes, 0.0);
+        std::fill(body.forceY, body.forceY + Lanes, 0.0);
+
+        if (!body.imrotatable) {
+            for (size_t l = 0; l < Lanes; l++) {
+                body.rotAcc[l] = body.tourqe[l] / body.moofin;
+                body.rotVel[l] += body.rotAcc[l] * dt;
+                body.rotation[l] = body.rotation[l] + body.rotVel[l] * dt;
+            }
+            for (size_t l = 0; l < Lanes; l++) {
+                body.cosθ[l] = std::cos(body.rotation[l]);
+                body.sinθ[l] = std::sin(body.rotation[l]);
+            }
+        }
+        std::fill(body.tourqe, body.tourqe + Lanes, 0.0);
+    }
+
+    // the same as setPoints and setHitbox, the local vertices are shared by every lane
+    void refresh(BodyLanes& body) {
+        const DVec2* vertices = body.shape->vertices.data();
+        PointLanes* bodyPoints = points.data() + body.firstPoint;
+        for (size_t v = 0; v < body.degree; v++) {
+            double x = vertices[v].x;
+            double y = vertices[v].y;
+            for (size_t l = 0; l < Lanes; l++) {
+                bodyPoints[v].x[l] = body.midX[l] + (x*body.cosθ[l] - y*body.sinθ[l]);
+                bodyPoints[v].y[l] = body.midY[l] + (x*body.sinθ[l] + y*body.cosθ[l]);
+            }
+        }
+
+        alignas(Lanes*sizeof(double)) double top[Lanes], bottom[Lanes], left[Lanes], right[Lanes];
+        for (size_t l = 0; l < Lanes; l++) {
+            top[l] = bottom[l] = bodyPoints[0].y[l];
+            left[l] = right[l] = bodyPoints[0].x[l];
+        }
+        for (size_t v = 1; v < body.degree; v++) {
+            for (size_t l = 0; l < Lanes; l++) {
+                top[l] = std::max(top[l], bodyPoints[v].y[l]);
+                bottom[l] = std::min(bottom[l], bodyPoints[v].y[l]);
+                left[l] = std::min(left[l], bodyPoints[v].x[l]);
+                right[l] = std::max(right[l], bodyPoints[v].x[l]);
+            }
+        }
+        for (size_t l = 0; l < Lanes; l++) {
+            body.hitboxWidth[l] = right[l] - left[l];
+            body.hitboxHeight[l] = top[l] - bottom[l];
+            body.hitboxX[l] = left[l];
+            body.hitboxY[l] = bottom[l];
+        }
+    }
+};